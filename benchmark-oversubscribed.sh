@@ -0,0 +1,53 @@
+#!/bin/bash
+
+# Runs the list with 1x, 2x and 4x as many threads as there are CPUs, for
+# every wait policy of synchronize().
+
+BENCH_BIN=./benchmarks/bench-list
+
+if [ ! -f "${BENCH_BIN}" ]
+then
+  echo "error: Could not find the benchmark program at \`${BENCH_BIN}\`. Please build the project first."
+  exit 1
+fi
+
+if [ $# -lt 3 ]; then
+  echo "Usage: $(basename $0) (rlu|rlu-hash|...) UPDATE-RATIO OUTPUT-DIR"
+  exit 1
+fi
+
+CPUS=`nproc`
+N_THREADS=(${CPUS} $((CPUS * 2)) $((CPUS * 4)))
+WAIT_POLICIES=(spin yield block)
+MIN_VALUE=0
+MAX_VALUE=2047
+INITIAL_SIZE=1024
+DURATION=10
+
+SCHEME=$1
+UPDATE_RATIO=$2
+OUTPUT_DIR=$3
+
+mkdir -p ${OUTPUT_DIR}
+
+OUTPUT_FILE=${OUTPUT_DIR}/oversubscribed_${SCHEME}_${UPDATE_RATIO}.txt
+
+echo "scheme,update_ratio,wait,cpus,threads,ops,time,ops_per_us" \
+  >${OUTPUT_FILE}
+
+for WAIT in ${WAIT_POLICIES[*]}
+do
+  for THREADS in ${N_THREADS[*]}
+  do
+    echo -n "scheme=${SCHEME}, wait=${WAIT}, threads=${THREADS}... "
+
+    OUTPUT=`${BENCH_BIN} ${SCHEME} --min-value ${MIN_VALUE} --max-value \
+      ${MAX_VALUE} --initial-size ${INITIAL_SIZE} --duration ${DURATION} \
+      --threads ${THREADS} --update-ratio ${UPDATE_RATIO} --wait ${WAIT} \
+      2>/dev/null | grep -v '#' | cut -d, -f1-3`
+
+    echo "${SCHEME},${UPDATE_RATIO},${WAIT},${CPUS},${THREADS},${OUTPUT}" \
+      >>${OUTPUT_FILE}
+    echo "done."
+  done
+done
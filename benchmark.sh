@@ -27,7 +27,11 @@ mkdir -p ${OUTPUT_DIR}
 
 OUTPUT_FILE=${OUTPUT_DIR}/benchmark_${SCHEME}_${UPDATE_RATIO}.txt
 
-echo "scheme,threads,update_ratio,ops,time,ops_per_us,add,erase,contains,found" >${OUTPUT_FILE}
+echo "scheme,threads,update_ratio,ops,time,ops_per_us,add,erase,contains,found,\
+scan,add_p50,add_p99,add_p999,erase_p50,erase_p99,erase_p999,\
+contains_p50,contains_p99,contains_p999,scan_p50,scan_p99,scan_p999,\
+affinity,cpus,nodes,commits,grace_periods,keys_per_us,bytes_per_key" \
+  >${OUTPUT_FILE}
 
 for CORES in ${N_THREADS[*]}
 do
@@ -35,7 +39,8 @@ do
 
   OUTPUT=`${BENCH_BIN} ${SCHEME} --min-value ${MIN_VALUE} --max-value \
     ${MAX_VALUE} --initial-size ${INITIAL_SIZE} --duration ${DURATION} \
-    --threads ${CORES} --update-ratio ${UPDATE_RATIO} 2>/dev/null | grep -v '#'`
+    --threads ${CORES} --update-ratio ${UPDATE_RATIO} \
+    ${AFFINITY:+--affinity ${AFFINITY}} 2>/dev/null | grep -v '#'`
 
   echo "${SCHEME},${UPDATE_RATIO},${CORES},${OUTPUT}" >>${OUTPUT_FILE}
   echo "done."
@@ -3,6 +3,13 @@
 #include <stdexcept>
 
 #include "benchmark.hh"
+#include "hash-map.hh"
+#include "list.hh"
+#include "rcu-list.hh"
+#include "rcu-tree.hh"
+#include "skip-list.hh"
+#include "tree.hh"
+#include "unrolled-list.hh"
 
 using namespace std;
 
@@ -11,9 +18,51 @@ inline void print_exception(const char *argv0, const exception &e)
   cerr << argv0 << ": " << e.what() << endl;
 }
 
+rlu::context::ContentionPolicy parse_policy(const string &name)
+{
+  using rlu::context::ContentionPolicy;
+
+  if (name == "none") return ContentionPolicy::None;
+  if (name == "backoff") return ContentionPolicy::Backoff;
+  if (name == "wait") return ContentionPolicy::WaitForHolder;
+  if (name == "priority") return ContentionPolicy::Priority;
+
+  throw runtime_error("unknown contention policy: " + name);
+}
+
+rlu::context::WaitPolicy parse_wait_policy(const string &name)
+{
+  using rlu::context::WaitPolicy;
+
+  if (name == "spin") return WaitPolicy::Spin;
+  if (name == "yield") return WaitPolicy::Yield;
+  if (name == "block") return WaitPolicy::Block;
+
+  throw runtime_error("unknown wait policy: " + name);
+}
+
+rlu::context::ClockSource parse_clock(const string &name)
+{
+  using rlu::context::ClockSource;
+
+  if (name == "logical") return ClockSource::Logical;
+  if (name == "ordo") return ClockSource::Ordo;
+
+  throw runtime_error("unknown clock: " + name);
+}
+
 void usage(const char *argv0, const int exit_code)
 {
-  cerr << "usage: " << argv0 << " (rlu|rcu) [OPTIONS]" << endl
+  cerr << "usage: " << argv0 << " MODE [OPTIONS]" << endl
+       << endl
+       << "modes:" << endl
+       << "  rlu, rlu-deferred, rlu-async RLU linked list" << endl
+       << "  rlu-hash, rlu-hash-deferred  RLU resizable hash set" << endl
+       << "  rlu-skiplist                 RLU skip list" << endl
+       << "  rlu-unrolled                 RLU unrolled linked list" << endl
+       << "  rlu-tree                     RLU search tree (Citrus)" << endl
+       << "  rcu                          RCU linked list (liburcu)" << endl
+       << "  rcu-tree                     RCU search tree (liburcu)" << endl
        << endl
        << "options:" << endl
        << "  -n, --threads <N=8>" << endl
@@ -22,6 +71,29 @@ void usage(const char *argv0, const int exit_code)
        << "  -M, --max-value <V=1023>" << endl
        << "  -i, --initial-size <S=512>" << endl
        << "  -d, --duration <D=2s>" << endl
+       << "  -a, --affinity <A=none>      thread pinning: none, compact, "
+       << "scatter," << endl
+       << "                               or a cpu list (0,2,4-7)" << endl
+       << "  -L, --numa-local             NUMA-local RLU thread contexts and "
+       << "nodes" << endl
+       << "  -c, --contention <P=none>    RLU contention policy: none, "
+       << "backoff, wait, priority" << endl
+       << "  -w, --wait <W=block>         how writers wait for readers: spin, "
+       << "yield, block" << endl
+       << "  -G, --group-commit           combine concurrent commits' grace "
+       << "periods" << endl
+       << "  -C, --clock <C=logical>      RLU clock: logical, ordo (TSC-based)"
+       << endl
+       << "  -x, --mix <A:E:C[:S]>        weights of add, erase, contains and "
+       << "scan" << endl
+       << "                               (overrides --update-ratio)" << endl
+       << "  -k, --keys <D=uniform>       key distribution: uniform, "
+       << "zipf[:THETA]," << endl
+       << "                               hotspot[:KEYS:OPS] (fractions)"
+       << endl
+       << "  -s, --scan-length <L=64>     keys covered by a scan" << endl
+       << "  -B, --lookup-batch <N=1>     batch N lookups into one "
+       << "contains_many()" << endl
        << endl;
 
   exit(exit_code);
@@ -46,10 +118,21 @@ int main(int argc, char *argv[])
         {"min-value", required_argument, nullptr, 'm'},
         {"max-value", required_argument, nullptr, 'M'},
         {"initial-size", required_argument, nullptr, 'i'},
-        {"duration", required_argument, nullptr, 'd'}};
+        {"duration", required_argument, nullptr, 'd'},
+        {"affinity", required_argument, nullptr, 'a'},
+        {"numa-local", no_argument, nullptr, 'L'},
+        {"contention", required_argument, nullptr, 'c'},
+        {"wait", required_argument, nullptr, 'w'},
+        {"clock", required_argument, nullptr, 'C'},
+        {"group-commit", no_argument, nullptr, 'G'},
+        {"mix", required_argument, nullptr, 'x'},
+        {"keys", required_argument, nullptr, 'k'},
+        {"scan-length", required_argument, nullptr, 's'},
+        {"lookup-batch", required_argument, nullptr, 'B'}};
 
     while (true) {
-      const int opt = getopt_long(argc, argv, "n:r:m:M:i:d:h", long_options, 0);
+      const int opt = getopt_long(
+          argc, argv, "n:r:m:M:i:d:a:Lc:w:C:Gx:k:s:B:h", long_options, 0);
 
       if (opt == -1) break;
 
@@ -61,6 +144,16 @@ int main(int argc, char *argv[])
       case 'M': config.max_value = stol(optarg); break;
       case 'i': config.initial_size = stoul(optarg); break;
       case 'd': config.duration = chrono::seconds{stoul(optarg)}; break;
+      case 'a': config.affinity = optarg; break;
+      case 'L': config.numa_local = true; break;
+      case 'c': config.contention_policy = parse_policy(optarg); break;
+      case 'w': config.wait_policy = parse_wait_policy(optarg); break;
+      case 'C': config.clock_source = parse_clock(optarg); break;
+      case 'G': config.group_commit = true; break;
+      case 'x': config.mix = optarg; break;
+      case 'k': config.distribution = optarg; break;
+      case 's': config.scan_length = stoul(optarg); break;
+      case 'B': config.lookup_batch = stoul(optarg); break;
       case 'h': usage(argv[0], EXIT_SUCCESS); break;
       default: usage(argv[0], EXIT_FAILURE);
       }
@@ -80,10 +173,37 @@ int main(int argc, char *argv[])
     Benchmark benchmark{config};
 
     if (mode == "rcu") {
-      benchmark.run_rcu();
+      benchmark.run_rcu<rcu::List<int32_t>>();
+    }
+    else if (mode == "rcu-tree") {
+      benchmark.run_rcu<rcu::Tree<int32_t>>();
     }
     else if (mode == "rlu") {
-      benchmark.run_rlu();
+      benchmark.run_rlu<rlu::List<int32_t>>();
+    }
+    else if (mode == "rlu-deferred") {
+      benchmark.run_rlu<rlu::List<int32_t>>(
+          rlu::context::Thread::CommitMode::Deferred);
+    }
+    else if (mode == "rlu-async") {
+      benchmark.run_rlu<rlu::List<int32_t>>(
+          rlu::context::Thread::CommitMode::Async);
+    }
+    else if (mode == "rlu-hash") {
+      benchmark.run_rlu<rlu::HashSet<int32_t>>();
+    }
+    else if (mode == "rlu-hash-deferred") {
+      benchmark.run_rlu<rlu::HashSet<int32_t>>(
+          rlu::context::Thread::CommitMode::Deferred);
+    }
+    else if (mode == "rlu-skiplist") {
+      benchmark.run_rlu<rlu::SkipList<int32_t, int32_t>>();
+    }
+    else if (mode == "rlu-unrolled") {
+      benchmark.run_rlu<rlu::UnrolledList<int32_t>>();
+    }
+    else if (mode == "rlu-tree") {
+      benchmark.run_rlu<rlu::Tree<int32_t, int32_t>>();
     }
     else {
       usage(argv[0], EXIT_FAILURE);
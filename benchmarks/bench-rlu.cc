@@ -0,0 +1,415 @@
+#include <getopt.h>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "histogram.hh"
+#include "rlu.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * Microbenchmarks for the RLU primitives. Every measuring thread runs one
+ * primitive in batches and records the time per operation of each batch,
+ * while the background readers keep entering and leaving read sections (with
+ * a few dereferences in each), which is what the writers have to wait for.
+ */
+
+namespace {
+
+using clock_type = steady_clock;
+
+enum class Primitive {
+  Section,       // a reader_lock()/reader_unlock() pair
+  Deref,         // dereference() of an unlocked object
+  DerefSelf,     // ...of an object this thread has locked
+  DerefForeign,  // ...of an object another thread has locked
+  Write,         // try_lock(), and the commit in reader_unlock()
+  Sync,          // synchronize()
+};
+
+const array<pair<Primitive, const char *>, 6> PRIMITIVES{
+    {{Primitive::Section, "section"},
+     {Primitive::Deref, "deref"},
+     {Primitive::DerefSelf, "deref-self"},
+     {Primitive::DerefForeign, "deref-foreign"},
+     {Primitive::Write, "write"},
+     {Primitive::Sync, "sync"}}};
+
+/* the cheap primitives are timed in batches, so the clock doesn't dominate */
+constexpr size_t SECTION_BATCH = 256;
+constexpr size_t DEREF_BATCH = 1024;
+constexpr size_t OWN_OBJECTS = 16;  // locked by each thread for deref-self
+
+struct Object {
+  uint64_t value{0};
+};
+
+struct Config {
+  vector<size_t> threads{1};
+  vector<size_t> readers{0};
+  size_t objects = 1024;       // shared by all the threads
+  size_t section_length = 16;  // dereferences per background read section
+  seconds duration{1};
+};
+
+struct Result {
+  Histogram latency{};  // per operation, in picoseconds
+  uint64_t ops{0};
+  uint64_t ns{0};
+
+  void merge(const Result &other)
+  {
+    latency.merge(other.latency);
+    ops += other.ops;
+    ns += other.ns;
+  }
+};
+
+uint64_t ns_between(const clock_type::time_point start,
+                    const clock_type::time_point end)
+{
+  return duration_cast<nanoseconds>(end - start).count();
+}
+
+class Worker {
+private:
+  rlu::context::Thread &ctx_;
+  const vector<Object *> &shared_;
+  vector<Object *> own_{};
+  size_t next_{0};
+  uint64_t sink_{0};
+
+  Object *next_shared() { return shared_[next_++ % shared_.size()]; }
+
+public:
+  Worker(rlu::context::Thread &ctx, const vector<Object *> &shared)
+      : ctx_(ctx), shared_(shared)
+  {
+    for (size_t i = 0; i < OWN_OBJECTS; i++) {
+      own_.push_back(rlu::mem::alloc<Object>());
+    }
+  }
+
+  ~Worker()
+  {
+    for (auto obj : own_) rlu::mem::free(obj);
+  }
+
+  Worker(const Worker &) = delete;
+  Worker &operator=(const Worker &) = delete;
+
+  uint64_t sink() const { return sink_; }
+
+  /* runs a batch, and returns the number of operations and their time */
+  pair<size_t, uint64_t> run(const Primitive primitive);
+};
+
+pair<size_t, uint64_t> Worker::run(const Primitive primitive)
+{
+  clock_type::time_point start, end;
+
+  switch (primitive) {
+  case Primitive::Section:
+    start = clock_type::now();
+
+    for (size_t i = 0; i < SECTION_BATCH; i++) {
+      ctx_.reader_lock();
+      ctx_.reader_unlock();
+    }
+
+    end = clock_type::now();
+    return {SECTION_BATCH, ns_between(start, end)};
+
+  case Primitive::Deref:
+  case Primitive::DerefForeign:
+    ctx_.reader_lock();
+    start = clock_type::now();
+
+    for (size_t i = 0; i < DEREF_BATCH; i++) {
+      sink_ += ctx_.dereference(next_shared())->value;
+    }
+
+    end = clock_type::now();
+    ctx_.reader_unlock();
+    return {DEREF_BATCH, ns_between(start, end)};
+
+  case Primitive::DerefSelf: {
+    ctx_.reader_lock();
+
+    for (auto obj : own_) {
+      if (!ctx_.try_lock(obj)) throw runtime_error("own object is locked");
+    }
+
+    start = clock_type::now();
+
+    for (size_t i = 0; i < DEREF_BATCH; i++) {
+      sink_ += ctx_.dereference(own_[i % own_.size()])->value;
+    }
+
+    end = clock_type::now();
+    ctx_.reader_unlock();
+    return {DEREF_BATCH, ns_between(start, end)};
+  }
+
+  case Primitive::Write: {
+    auto obj = own_[next_++ % own_.size()];
+
+    ctx_.reader_lock();
+    start = clock_type::now();
+
+    if (!ctx_.try_lock(obj)) throw runtime_error("own object is locked");
+    obj->value++;
+    ctx_.reader_unlock();
+
+    end = clock_type::now();
+    return {1, ns_between(start, end)};
+  }
+
+  case Primitive::Sync:
+    start = clock_type::now();
+    ctx_.synchronize();
+    end = clock_type::now();
+    return {1, ns_between(start, end)};
+  }
+
+  return {0, 0};
+}
+
+Result measure(const Config &config, const Primitive primitive,
+               const size_t n_threads, const size_t n_readers)
+{
+  rlu::context::Global global_ctx;
+  vector<Object *> shared;
+
+  for (size_t i = 0; i < config.objects; i++) {
+    shared.push_back(rlu::mem::alloc<Object>());
+  }
+
+  atomic<bool> stop{false};
+  atomic<bool> locked{false};
+  atomic<size_t> measuring{n_threads};
+  vector<thread> background;
+
+  /* keeps every shared object locked, in a section that lasts until the
+     measuring threads are done (they can't unregister before it ends) */
+  if (primitive == Primitive::DerefForeign) {
+    background.emplace_back([&] {
+      auto &ctx = global_ctx.register_thread();
+      ctx.reader_lock();
+
+      for (auto obj : shared) {
+        if (!ctx.try_lock(obj)) throw runtime_error("shared object is locked");
+      }
+
+      locked = true;
+      while (measuring > 0) this_thread::sleep_for(1ms);
+
+      ctx.reader_unlock();
+      global_ctx.unregister_thread(ctx);
+    });
+
+    while (!locked) this_thread::yield();
+  }
+
+  for (size_t i = 0; i < n_readers; i++) {
+    background.emplace_back(
+        [&](const size_t reader_id) {
+          auto &ctx = global_ctx.register_thread();
+          mt19937 rng{static_cast<uint32_t>(reader_id)};
+          uint64_t sink = 0;
+
+          while (!stop) {
+            ctx.reader_lock();
+
+            for (size_t j = 0; j < config.section_length; j++) {
+              sink += ctx.dereference(shared[rng() % shared.size()])->value;
+            }
+
+            ctx.reader_unlock();
+          }
+
+          global_ctx.unregister_thread(ctx);
+          return sink;
+        },
+        i);
+  }
+
+  const auto start = clock_type::now() + 100ms;
+  const auto end = start + config.duration;
+  vector<Result> results(n_threads);
+  vector<thread> threads;
+
+  for (size_t i = 0; i < n_threads; i++) {
+    threads.emplace_back([&, i] {
+      auto &ctx = global_ctx.register_thread();
+
+      {
+        Worker worker{ctx, shared};
+        auto &result = results[i];
+
+        this_thread::sleep_until(start);
+
+        while (clock_type::now() < end) {
+          const auto [ops, ns] = worker.run(primitive);
+
+          result.latency.record(ns * 1000 / ops);
+          result.ops += ops;
+          result.ns += ns;
+        }
+
+        /* so the compiler can't drop the dereferences */
+        if (worker.sink() == numeric_limits<uint64_t>::max()) cerr << '.';
+      }
+
+      measuring--;
+
+      global_ctx.unregister_thread(ctx);
+    });
+  }
+
+  for (auto &t : threads) t.join();
+
+  stop = true;
+  for (auto &t : background) t.join();
+
+  for (auto obj : shared) rlu::mem::free(obj);
+
+  Result total;
+  for (auto &result : results) total.merge(result);
+  return total;
+}
+
+vector<size_t> parse_list(const string &list)
+{
+  vector<size_t> values;
+  stringstream ss{list};
+
+  for (string value; getline(ss, value, ',');) {
+    values.push_back(stoul(value));
+  }
+
+  if (values.empty()) throw runtime_error("empty list: " + list);
+  return values;
+}
+
+void usage(const char *argv0, const int exit_code)
+{
+  cerr << "usage: " << argv0 << " PRIMITIVE [OPTIONS]" << endl
+       << endl
+       << "primitives:" << endl
+       << "  section        reader_lock() + reader_unlock()" << endl
+       << "  deref          dereference() of an unlocked object" << endl
+       << "  deref-self     dereference() of an object we locked" << endl
+       << "  deref-foreign  dereference() of an object another thread locked"
+       << endl
+       << "  write          try_lock() + commit" << endl
+       << "  sync           synchronize()" << endl
+       << "  all            every one of the above" << endl
+       << endl
+       << "options:" << endl
+       << "  -n, --threads <N=1>          measuring threads (a list, e.g. "
+       << "1,2,4)" << endl
+       << "  -R, --readers <N=0>          background readers (a list)" << endl
+       << "  -o, --objects <N=1024>       shared objects" << endl
+       << "  -l, --section-length <L=16>  dereferences per background section"
+       << endl
+       << "  -d, --duration <D=1s>        per measurement" << endl
+       << endl;
+
+  exit(exit_code);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  try {
+    if (argc <= 0) {
+      abort();
+    }
+
+    if (argc < 2) {
+      usage(argv[0], EXIT_FAILURE);
+    }
+
+    Config config;
+
+    struct option long_options[] = {
+        {"threads", required_argument, nullptr, 'n'},
+        {"readers", required_argument, nullptr, 'R'},
+        {"objects", required_argument, nullptr, 'o'},
+        {"section-length", required_argument, nullptr, 'l'},
+        {"duration", required_argument, nullptr, 'd'}};
+
+    while (true) {
+      const int opt = getopt_long(argc, argv, "n:R:o:l:d:h", long_options, 0);
+
+      if (opt == -1) break;
+
+      // clang-format off
+      switch (opt) {
+      case 'n': config.threads = parse_list(optarg); break;
+      case 'R': config.readers = parse_list(optarg); break;
+      case 'o': config.objects = stoul(optarg); break;
+      case 'l': config.section_length = stoul(optarg); break;
+      case 'd': config.duration = seconds{stoul(optarg)}; break;
+      case 'h': usage(argv[0], EXIT_SUCCESS); break;
+      default: usage(argv[0], EXIT_FAILURE);
+      }
+      // clang-format on
+    }
+
+    if (optind >= argc || config.objects == 0) {
+      usage(argv[0], EXIT_FAILURE);
+    }
+
+    const string mode = argv[optind];
+    vector<pair<Primitive, const char *>> primitives;
+
+    for (auto &primitive : PRIMITIVES) {
+      if (mode == "all" || mode == primitive.second) {
+        primitives.push_back(primitive);
+      }
+    }
+
+    if (primitives.empty()) {
+      usage(argv[0], EXIT_FAILURE);
+    }
+
+    cout << "# primitive,threads,readers,ops,ns_per_op,p50,p99,p999" << endl;
+
+    for (auto &[primitive, name] : primitives) {
+      for (const auto n_threads : config.threads) {
+        for (const auto n_readers : config.readers) {
+          if (n_threads + n_readers + 1 > rlu::MAX_THREADS) {
+            throw runtime_error("too many threads");
+          }
+
+          const auto result = measure(config, primitive, n_threads, n_readers);
+          const double ns_per_op =
+              result.ops ? (1.0 * result.ns / result.ops) : 0.0;
+
+          cout << name << "," << n_threads << "," << n_readers << ","
+               << result.ops << "," << fixed << setprecision(3) << ns_per_op
+               << "," << result.latency.percentile(50) / 1000.0 << ","
+               << result.latency.percentile(99) / 1000.0 << ","
+               << result.latency.percentile(99.9) / 1000.0 << endl;
+        }
+      }
+    }
+  }
+  catch (exception &ex) {
+    cerr << argv[0] << ": " << ex.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -3,29 +3,95 @@
 #include <future>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <thread>
+#include <type_traits>
 
+#include "hash-map.hh"
 #include "list.hh"
 #include "rcu-list.hh"
+#include "rcu-tree.hh"
 #include "rlu.hh"
+#include "skip-list.hh"
+#include "tree.hh"
+#include "unrolled-list.hh"
 
 using namespace std;
 using namespace std::chrono;
 
-int32_t randint(const int32_t min, const int32_t max)
+/* detects sets with a `for_each_range()` to run scans on; the visitor takes
+   the keys of a set and the pairs of a map alike */
+struct ScanVisitor {
+  template <class... Args>
+  void operator()(Args &&...) const
+  {
+  }
+};
+
+template <class Set, class = void>
+struct has_range_scan : false_type {};
+
+template <class Set>
+struct has_range_scan<
+    Set, void_t<decltype(declval<Set &>().for_each_range(
+             declval<rlu::context::Thread &>(), int32_t{}, int32_t{},
+             ScanVisitor{}))>> : true_type {};
+
+/* ...and sets with a `contains_many()` to run batched lookups on */
+template <class Set, class = void>
+struct has_contains_many : false_type {};
+
+template <class Set>
+struct has_contains_many<
+    Set, void_t<decltype(declval<Set &>().contains_many(
+             declval<rlu::context::Thread &>(), declval<vector<int32_t> &>(),
+             declval<vector<bool> &>()))>> : true_type {};
+
+uint64_t seed()
+{
+  static random_device dev;
+  static mutex lock;
+
+  lock_guard<mutex> guard{lock};
+  return (uint64_t{dev()} << 32) | dev();
+}
+
+Workload::Config Benchmark::workload_config(const Config &config)
 {
-  static thread_local random_device dev;
-  static thread_local mt19937 rng{dev()};
-  uniform_int_distribution<int32_t> distribution{min, max};
-  return distribution(rng);
+  Workload::Config workload;
+  workload.min_value = config.min_value;
+  workload.max_value = config.max_value;
+  workload.scan_length = config.scan_length;
+  workload.set_distribution(config.distribution);
+
+  if (config.mix.empty()) {
+    const double r = config.update_ratio;
+    workload.mix = {r / 2, r / 2, 1 - r, 0};
+  }
+  else {
+    workload.set_mix(config.mix);
+  }
+
+  return workload;
 }
 
-bool coinflip(const float p_true = 0.5)
+Topology Benchmark::topology(const Config &config)
 {
-  static thread_local random_device dev;
-  static thread_local mt19937 rng{dev()};
-  bernoulli_distribution distribution{p_true};
-  return distribution(rng);
+  Topology topology;
+  topology.set_affinity(config.affinity);
+  return topology;
+}
+
+void Benchmark::place_threads()
+{
+  aggregate_.affinity = topology_.policy_name();
+  aggregate_.cpus = topology_.cpus(config_.n_threads);
+  aggregate_.nodes = topology_.nodes(config_.n_threads);
+}
+
+uint64_t nanoseconds_since(const Benchmark::clock::time_point start)
+{
+  return duration_cast<nanoseconds>(Benchmark::clock::now() - start).count();
 }
 
 void Benchmark::Stats::merge(const Stats &other)
@@ -37,23 +103,58 @@ void Benchmark::Stats::merge(const Stats &other)
   count_erase += other.count_erase;
   count_contains += other.count_contains;
   count_found += other.count_found;
+  count_scan += other.count_scan;
+  count_scanned += other.count_scanned;
+
+  latency_add.merge(other.latency_add);
+  latency_erase.merge(other.latency_erase);
+  latency_contains.merge(other.latency_contains);
+  latency_scan.merge(other.latency_scan);
+  alloc.merge(other.alloc);
+  contention.merge(other.contention);
+  commits.merge(other.commits);
+  rlu.merge(other.rlu);
 }
 
 void Benchmark::Stats::print()
 {
   const auto d = duration_cast<microseconds>(end - start).count();
-  const auto total = count_add + count_erase + count_contains;
+  const auto total = count_add + count_erase + count_contains + count_scan;
 
   const float ops_per_us = (float)total / d;
+  const float keys_per_us = (float)count_contains / d;  // looked up
 
-  auto percentage = [](const int n, const int total) -> double {
+  auto percentage = [](const uint64_t n, const uint64_t total) -> double {
     return total ? (100.0 * n / total) : 0.0;
   };
 
-  cout << "# ops,time,ops_per_us,add,erase,contains,found" << endl;
+  const array<pair<const char *, const Histogram *>, 4> latencies{
+      {{"add", &latency_add},
+       {"erase", &latency_erase},
+       {"contains", &latency_contains},
+       {"scan", &latency_scan}}};
+
+  cout << "# ops,time,ops_per_us,add,erase,contains,found,scan";
+
+  for (auto &[name, histogram] : latencies) {
+    cout << "," << name << "_p50," << name << "_p99," << name << "_p999";
+  }
+
+  cout << ",affinity,cpus,nodes,commits,grace_periods,keys_per_us,"
+       << "bytes_per_key" << endl;
 
   cout << total << "," << d << "," << ops_per_us << "," << count_add << ","
-       << count_erase << "," << count_contains << "," << count_found << endl;
+       << count_erase << "," << count_contains << "," << count_found << ","
+       << count_scan;
+
+  for (auto &[name, histogram] : latencies) {
+    cout << "," << histogram->percentile(50) << ","
+         << histogram->percentile(99) << "," << histogram->percentile(99.9);
+  }
+
+  cout << "," << affinity << "," << cpus << "," << nodes << ","
+       << commits.commits << "," << commits.grace_periods << ","
+       << keys_per_us << "," << bytes_per_key << endl;
 
   cerr << endl
        << "  Duration: " << fixed << setprecision(3) << (d / 1e6) << "s" << endl
@@ -66,27 +167,111 @@ void Benchmark::Stats::print()
        << percentage(count_contains, total) << "%)" << endl
        << "     Found: " << count_found << " (" << fixed << setprecision(2)
        << percentage(count_found, count_contains) << "%)" << endl
+       << "      Scan: " << count_scan << " (" << fixed << setprecision(2)
+       << percentage(count_scan, total) << "%, "
+       << (count_scan ? count_scanned / count_scan : 0) << " keys each)"
+       << endl
        << "       Ops: " << total << endl
        << "      Time: " << d << endl
-       << "    Ops/us: " << ops_per_us << endl;
+       << "    Ops/us: " << ops_per_us << endl
+       << "   Keys/us: " << keys_per_us << " (looked up)" << endl
+       << "  Affinity: " << affinity;
+
+  if (!cpus.empty()) cerr << " (cpus " << cpus << "; nodes " << nodes << ")";
+  cerr << endl;
+
+  cerr << endl
+       << "  Latency (ns)       p50       p99      p999       max" << endl;
+
+  for (auto &[name, histogram] : latencies) {
+    if (histogram->count() == 0) continue;
+
+    cerr << "  " << setw(8) << name << setw(12) << histogram->percentile(50)
+         << setw(10) << histogram->percentile(99) << setw(10)
+         << histogram->percentile(99.9) << setw(10) << histogram->max()
+         << endl;
+  }
+
+  cerr << endl;
+
+  if (bytes_per_key > 0) {
+    cerr << "  Bytes/key: " << fixed << setprecision(2) << bytes_per_key
+         << " (initial set)" << endl;
+  }
 
+  if (alloc.allocs + alloc.frees > 0) {
+    auto per_op = [total](const uint64_t n) -> double {
+      return total ? (1.0 * n / total) : 0.0;
+    };
+
+    cerr << "  Allocs/op: " << fixed << setprecision(4) << per_op(alloc.allocs)
+         << endl
+         << "   Frees/op: " << per_op(alloc.frees) << " ("
+         << setprecision(2) << percentage(alloc.remote_frees, alloc.frees)
+         << "% remote)" << endl
+         << "     Chunks: " << alloc.chunks << endl;
+  }
+
+  if (contention.aborts > 0) {
+    cerr << "  Aborts/op: " << fixed << setprecision(4)
+         << (total ? (1.0 * contention.aborts / total) : 0.0) << endl
+         << "      Waits: " << contention.waits << endl
+         << "Max retries: " << contention.max_retries << endl;
+  }
+
+  if (commits.commits > 0) {
+    cerr << "        Commits: " << commits.commits << endl
+         << "  Grace periods: " << commits.grace_periods << " ("
+         << setprecision(2)
+         << (commits.grace_periods
+                 ? (1.0 * commits.commits / commits.grace_periods)
+                 : 0.0)
+         << " commits each)" << endl;
+  }
+
+  if (rlu::context::STATS_ENABLED) {
+    const auto sections = rlu.read_sections + rlu.write_sections;
+
+    cerr << endl
+         << "  RLU stats:" << endl
+         << "  Read sections: " << rlu.read_sections << endl
+         << " Write sections: " << rlu.write_sections << endl
+         << "         Aborts: " << rlu.aborts << endl
+         << "  Lock failures: " << rlu.lock_failures << endl
+         << "         Steals: " << rlu.steals << " (" << setprecision(2)
+         << (sections ? (1.0 * rlu.steals / sections) : 0.0)
+         << " per section)" << endl
+         << "      Log bytes: " << rlu.log_bytes << endl
+         << "          Syncs: " << rlu.syncs << endl
+         << "    Sync cycles: " << rlu.sync_cycles << " ("
+         << (rlu.syncs ? rlu.sync_cycles / rlu.syncs : 0) << " per sync)"
+         << endl
+         << "    Sync sleeps: " << rlu.sync_sleeps << endl;
+  }
 }
 
-void Benchmark::run_rlu()
+template <class Set>
+void Benchmark::run_rlu(const rlu::context::Thread::CommitMode commit_mode)
 {
   vector<future<Stats>> thread_stats;
 
-  /* create the global and thread contexts */
-  rlu::context::Global global_ctx;
+  if (workload_.has_scans() && !has_range_scan<Set>::value) {
+    throw runtime_error("scans are not supported in this mode");
+  }
 
-  for (size_t i = 0; i < config_.n_threads; i++) {
-    global_ctx.threads.emplace_back(
-        make_unique<rlu::context::Thread>(i, global_ctx));
+  if (config_.lookup_batch > 1 && !has_contains_many<Set>::value) {
+    throw runtime_error("batched lookups are not supported in this mode");
   }
 
+  /* create the global context; the threads register themselves */
+  rlu::context::Global global_ctx{config_.numa_local, config_.clock_source};
+  rlu::mem::Heap::set_numa_local(config_.numa_local);
+  place_threads();
+
   /* create the data structure */
-  rlu::List<int32_t> list{config_.initial_size, config_.min_value,
-                          config_.max_value};
+  const auto empty = rlu::mem::Heap::total_stats();
+  Set set{config_.initial_size, config_.min_value, config_.max_value};
+  const auto alloc_start = rlu::mem::Heap::total_stats();
 
   /* set the start time */
   cerr << "Starting the benchmark in 1 second..." << endl;
@@ -99,56 +284,128 @@ void Benchmark::run_rlu()
   for (size_t i = 0; i < config_.n_threads; i++) {
     thread_stats.emplace_back(async(
         launch::async,
-        [&](const size_t, rlu::context::Thread &thread_ctx) {
+        [&](const size_t thread_index) {
           Stats thread_stats;
 
+          /* pinned before anything is allocated, so it's all local */
+          topology_.pin(thread_index);
+
+          auto &thread_ctx = global_ctx.register_thread(commit_mode);
+          thread_ctx.set_contention_policy(config_.contention_policy);
+          thread_ctx.set_wait_policy(config_.wait_policy);
+          thread_ctx.set_group_commit(config_.group_commit);
+
+          if (config_.numa_local && !thread_ctx.migrate_to_local_node()) {
+            cerr << "warning: could not migrate thread context" << endl;
+          }
+
           this_thread::sleep_until(experiment_start);
           thread_stats.start = clock::now();
 
-          while (clock::now() < experiment_end) {
-            const bool is_writer = coinflip(config_.update_ratio);
-            const auto randval = randint(config_.min_value, config_.max_value);
+          Workload::Generator generator{workload_, seed()};
+          const auto scan_length = workload_.config().scan_length;
 
-            if (!is_writer) {
-              thread_stats.count_found += list.contains(thread_ctx, randval);
-              thread_stats.count_contains++;
-            }
-            else {
-              const bool is_adder = coinflip();
+          vector<int32_t> lookups;  // batched, with --lookup-batch
+          vector<bool> found;
+          lookups.reserve(config_.lookup_batch);
 
-              if (is_adder) {
-                list.add(thread_ctx, randval);
-                thread_stats.count_add++;
+          while (clock::now() < experiment_end) {
+            const auto [op, key] = generator.next();
+            const auto op_start = clock::now();
+
+            switch (op) {
+            case Workload::Op::Contains:
+              if constexpr (has_contains_many<Set>::value) {
+                if (config_.lookup_batch > 1) {
+                  lookups.push_back(key);
+                  if (lookups.size() < config_.lookup_batch) break;
+
+                  /* the latency of a lookup is its share of the batch's */
+                  thread_stats.count_found +=
+                      set.contains_many(thread_ctx, lookups, found);
+                  thread_stats.count_contains += lookups.size();
+                  thread_stats.latency_contains.record(
+                      nanoseconds_since(op_start) / lookups.size());
+
+                  lookups.clear();
+                  break;
+                }
               }
-              else {
-                list.erase(thread_ctx, randval);
-                thread_stats.count_erase++;
+
+              thread_stats.count_found += set.contains(thread_ctx, key);
+              thread_stats.count_contains++;
+              thread_stats.latency_contains.record(nanoseconds_since(op_start));
+              break;
+
+            case Workload::Op::Add:
+              set.add(thread_ctx, key);
+              thread_stats.count_add++;
+              thread_stats.latency_add.record(nanoseconds_since(op_start));
+              break;
+
+            case Workload::Op::Erase:
+              set.erase(thread_ctx, key);
+              thread_stats.count_erase++;
+              thread_stats.latency_erase.record(nanoseconds_since(op_start));
+              break;
+
+            case Workload::Op::Scan:
+              if constexpr (has_range_scan<Set>::value) {
+                const auto hi = static_cast<int32_t>(
+                    min<int64_t>(int64_t{key} + scan_length - 1,
+                                 numeric_limits<int32_t>::max() - 1));
+
+                thread_stats.count_scanned +=
+                    set.for_each_range(thread_ctx, key, hi, ScanVisitor{});
+                thread_stats.count_scan++;
+                thread_stats.latency_scan.record(nanoseconds_since(op_start));
               }
+              break;
             }
           }
 
           thread_stats.end = clock::now();
+          thread_stats.contention = thread_ctx.contention_stats();
+          thread_stats.commits = thread_ctx.commit_stats();
+          global_ctx.unregister_thread(thread_ctx);
           return thread_stats;
         },
-        i, ref(*global_ctx.threads[i])));
+        i));
   }
 
   for (auto &waitable : thread_stats) {
     aggregate_.merge(waitable.get());
   }
 
+  aggregate_.alloc = rlu::mem::Heap::total_stats() - alloc_start;
+
+  if (config_.initial_size > 0) {
+    aggregate_.bytes_per_key = 1.0 * (alloc_start - empty).live_bytes() /
+                               config_.initial_size;
+  }
+
+  aggregate_.rlu = global_ctx.stats();
   aggregate_.print();
 }
 
+template <class Set>
 void Benchmark::run_rcu()
 {
   vector<future<Stats>> thread_stats;
 
+  if (workload_.has_scans()) {
+    throw runtime_error("scans are not supported in this mode");
+  }
+
+  if (config_.lookup_batch > 1) {
+    throw runtime_error("batched lookups are not supported in this mode");
+  }
+
   rcu_init();
+  place_threads();
 
   /* create the data structure */
-  rcu::List<int32_t> list{config_.initial_size, config_.min_value,
-                          config_.max_value};
+  Set set{config_.initial_size, config_.min_value, config_.max_value};
 
   /* set the start time */
   cerr << "Starting the benchmark in 1 second..." << endl;
@@ -161,33 +418,41 @@ void Benchmark::run_rcu()
   for (size_t i = 0; i < config_.n_threads; i++) {
     thread_stats.emplace_back(async(
         launch::async,
-        [&](const size_t) {
+        [&](const size_t thread_index) {
           Stats thread_stats;
 
+          topology_.pin(thread_index);
           rcu_register_thread();
 
           this_thread::sleep_until(experiment_start);
           thread_stats.start = clock::now();
 
+          Workload::Generator generator{workload_, seed()};
+
           while (clock::now() < experiment_end) {
-            const bool is_writer = coinflip(config_.update_ratio);
-            const auto randval = randint(config_.min_value, config_.max_value);
+            const auto [op, key] = generator.next();
+            const auto op_start = clock::now();
 
-            if (!is_writer) {
-              thread_stats.count_found += list.contains(randval);
+            switch (op) {
+            case Workload::Op::Contains:
+              thread_stats.count_found += set.contains(key);
               thread_stats.count_contains++;
-            }
-            else {
-              const bool is_adder = coinflip();
-
-              if (is_adder) {
-                list.add(randval);
-                thread_stats.count_add++;
-              }
-              else {
-                list.erase(randval);
-                thread_stats.count_erase++;
-              }
+              thread_stats.latency_contains.record(nanoseconds_since(op_start));
+              break;
+
+            case Workload::Op::Add:
+              set.add(key);
+              thread_stats.count_add++;
+              thread_stats.latency_add.record(nanoseconds_since(op_start));
+              break;
+
+            case Workload::Op::Erase:
+              set.erase(key);
+              thread_stats.count_erase++;
+              thread_stats.latency_erase.record(nanoseconds_since(op_start));
+              break;
+
+            case Workload::Op::Scan: break;
             }
           }
 
@@ -206,3 +471,17 @@ void Benchmark::run_rcu()
 
   aggregate_.print();
 }
+
+template void Benchmark::run_rlu<rlu::List<int32_t>>(
+    const rlu::context::Thread::CommitMode);
+template void Benchmark::run_rlu<rlu::HashSet<int32_t>>(
+    const rlu::context::Thread::CommitMode);
+template void Benchmark::run_rlu<rlu::SkipList<int32_t, int32_t>>(
+    const rlu::context::Thread::CommitMode);
+template void Benchmark::run_rlu<rlu::Tree<int32_t, int32_t>>(
+    const rlu::context::Thread::CommitMode);
+template void Benchmark::run_rlu<rlu::UnrolledList<int32_t>>(
+    const rlu::context::Thread::CommitMode);
+
+template void Benchmark::run_rcu<rcu::List<int32_t>>();
+template void Benchmark::run_rcu<rcu::Tree<int32_t>>();
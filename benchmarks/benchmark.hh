@@ -3,8 +3,14 @@
 
 #include <chrono>
 #include <random>
+#include <string>
 #include <thread>
 
+#include "histogram.hh"
+#include "rlu.hh"
+#include "topology.hh"
+#include "workload.hh"
+
 class Benchmark {
 public:
   using clock = std::chrono::high_resolution_clock;
@@ -15,7 +21,22 @@ public:
     int32_t min_value = -1024;
     int32_t max_value = 1023;
     size_t initial_size = 512;
+
+    /* the workload; without a mix, `update_ratio` is split evenly between
+       adds and erases */
+    std::string mix{};
+    std::string distribution{"uniform"};
+    size_t scan_length = 64;
+    size_t lookup_batch = 1;  // keys per contains_many(), if above 1
     std::chrono::seconds duration{2};
+    bool numa_local = false;
+    std::string affinity{"none"};  // see Topology::set_affinity()
+    rlu::context::ContentionPolicy contention_policy =
+        rlu::context::ContentionPolicy::None;
+    rlu::context::WaitPolicy wait_policy = rlu::context::WaitPolicy::Block;
+    rlu::context::ClockSource clock_source =
+        rlu::context::ClockSource::Logical;
+    bool group_commit = false;
   };
 
   struct Stats {
@@ -26,6 +47,26 @@ public:
     size_t count_erase{0};
     size_t count_contains{0};
     size_t count_found{0};
+    size_t count_scan{0};
+    size_t count_scanned{0};  // keys visited by the scans
+
+    /* per-operation latencies, in nanoseconds */
+    Histogram latency_add{};
+    Histogram latency_erase{};
+    Histogram latency_contains{};
+    Histogram latency_scan{};
+
+    /* RLU object allocations during the run */
+    rlu::mem::AllocStats alloc{};
+    double bytes_per_key{0};  // taken by the initial set, slack included
+    rlu::context::ContentionStats contention{};
+    rlu::context::CommitStats commits{};
+    rlu::context::ThreadStats rlu{};  // with RLU_STATS
+
+    /* where the threads ran */
+    std::string affinity{"none"};
+    std::string cpus{};
+    std::string nodes{};
 
     void merge(const Stats& stats);
     void print();
@@ -33,11 +74,29 @@ public:
 
 private:
   const Config config_;
+  const Workload workload_;
+  const Topology topology_;
   Stats aggregate_{};
 
+  static Workload::Config workload_config(const Config& config);
+  static Topology topology(const Config& config);
+
+  /* records where the threads run */
+  void place_threads();
+
 public:
-  Benchmark(const Config& config) : config_(config) {}
-  void run_rlu();
+  Benchmark(const Config& config)
+      : config_(config),
+        workload_(workload_config(config)),
+        topology_(topology(config))
+  {
+  }
+
+  template <class Set>
+  void run_rlu(const rlu::context::Thread::CommitMode commit_mode =
+                   rlu::context::Thread::CommitMode::Immediate);
+
+  template <class Set>
   void run_rcu();
 };
 
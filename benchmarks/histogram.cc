@@ -0,0 +1,41 @@
+#include "histogram.hh"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+uint64_t Histogram::highest_in(const size_t bucket)
+{
+  if (bucket < 2 * SUB_BUCKETS) return bucket;
+
+  const size_t shift = bucket / SUB_BUCKETS - 1;
+  const uint64_t lowest = (bucket % SUB_BUCKETS + SUB_BUCKETS) << shift;
+  return lowest + ((1ull << shift) - 1);
+}
+
+void Histogram::merge(const Histogram& other)
+{
+  for (size_t i = 0; i < BUCKETS; i++) counts_[i] += other.counts_[i];
+
+  count_ += other.count_;
+  sum_ += other.sum_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+}
+
+uint64_t Histogram::percentile(const double p) const
+{
+  if (count_ == 0) return 0;
+
+  const auto rank =
+      std::max<uint64_t>(1, static_cast<uint64_t>(ceil(p / 100.0 * count_)));
+  uint64_t seen = 0;
+
+  for (size_t i = 0; i < BUCKETS; i++) {
+    seen += counts_[i];
+    if (seen >= rank) return std::min(highest_in(i), max_);
+  }
+
+  return max_;
+}
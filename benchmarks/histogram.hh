@@ -0,0 +1,59 @@
+#ifndef HISTOGRAM_HH
+#define HISTOGRAM_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/*
+ * An HDR-style latency histogram: values below 2 * SUB_BUCKETS get a bucket
+ * each, and every power of two above that is split into SUB_BUCKETS linear
+ * buckets, so any recorded value is off by at most 1/SUB_BUCKETS (~6%).
+ */
+class Histogram {
+public:
+  static constexpr size_t SUB_BUCKET_BITS = 4;
+  static constexpr size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static constexpr size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+private:
+  std::array<uint64_t, BUCKETS> counts_{};
+  uint64_t count_{0};
+  uint64_t sum_{0};
+  uint64_t min_{std::numeric_limits<uint64_t>::max()};
+  uint64_t max_{0};
+
+  static size_t bucket_of(const uint64_t value)
+  {
+    if (value < 2 * SUB_BUCKETS) return value;
+
+    const size_t shift = (63 - __builtin_clzll(value)) - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS);
+  }
+
+  /* the largest value that falls into `bucket` */
+  static uint64_t highest_in(const size_t bucket);
+
+public:
+  void record(const uint64_t value)
+  {
+    counts_[bucket_of(value)]++;
+    count_++;
+    sum_ += value;
+    if (value < min_) min_ = value;
+    if (value > max_) max_ = value;
+  }
+
+  void merge(const Histogram& other);
+
+  /* `p` is in [0, 100] */
+  uint64_t percentile(const double p) const;
+
+  uint64_t count() const { return count_; }
+  uint64_t min() const { return count_ ? min_ : 0; }
+  uint64_t max() const { return max_; }
+  double mean() const { return count_ ? (1.0 * sum_ / count_) : 0.0; }
+};
+
+#endif /* HISTOGRAM_HH */
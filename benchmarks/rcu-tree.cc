@@ -0,0 +1,147 @@
+#include "rcu-tree.hh"
+
+#include <random>
+
+using namespace std;
+using namespace rcu;
+
+template <class T>
+Tree<T>::Tree()
+{
+  // a max-node sentinel, the whole tree is its left child
+  root_ = new TreeNode<T>(numeric_limits<T>::max());
+}
+
+/*
+ * creates a tree with `n` random numbers (not thread-safe)
+ */
+template <class T>
+Tree<T>::Tree(const size_t n, const T min, const T max) : Tree()
+{
+  random_device dev;
+  mt19937 rng{dev()};
+  uniform_int_distribution<T> distribution{min, max};
+
+  size_t count = 0;
+
+  while (count != n) {
+    const T candidate = distribution(rng);
+    auto prev = root_;
+    size_t dir = 0;
+
+    for (auto curr = prev->child[0]; curr != nullptr; curr = prev->child[dir]) {
+      if (curr->value == candidate) break;
+      prev = curr;
+      dir = candidate > curr->value;
+    }
+
+    if (prev->child[dir] == nullptr) {
+      count++;
+      prev->child[dir] = new TreeNode<T>(candidate);
+    }
+  }
+}
+
+/* reducing the cost of synchronization, by only doing it every once in a
+   while */
+template <class T>
+void Tree<T>::free_later(NodePtr node)
+{
+  static thread_local NodePtr to_free[2048];
+  static thread_local size_t tf_index = 0;
+
+  to_free[tf_index++] = node;
+
+  if (tf_index >= 2048) {
+    synchronize_rcu();
+    for (size_t i = 0; i < tf_index; i++) delete to_free[i];
+    tf_index = 0;
+  }
+}
+
+template <class T>
+bool Tree<T>::add(const T value)
+{
+  unique_lock<mutex> lock{write_mutex_};
+
+  auto prev = root_;
+  size_t dir = 0;
+
+  for (auto curr = prev->child[0]; curr != nullptr; curr = prev->child[dir]) {
+    if (curr->value == value) return false;
+    prev = curr;
+    dir = value > curr->value;
+  }
+
+  prev->child[dir] = new TreeNode<T>(value);
+  return true;
+}
+
+template <class T>
+bool Tree<T>::erase(const T value)
+{
+  unique_lock<mutex> lock{write_mutex_};
+
+  auto prev = root_;
+  auto curr = prev->child[0];
+  size_t dir = 0;
+
+  while (curr != nullptr && curr->value != value) {
+    prev = curr;
+    dir = value > curr->value;
+    curr = prev->child[dir];
+  }
+
+  if (curr == nullptr) return false;
+
+  if (curr->child[0] == nullptr || curr->child[1] == nullptr) {
+    prev->child[dir] = curr->child[curr->child[0] == nullptr];
+
+    lock.unlock();
+    free_later(curr);
+    return true;
+  }
+
+  /* two children: a fresh copy of the successor replaces curr */
+  auto succ_prev = curr;
+  auto succ = curr->child[1];
+
+  while (succ->child[0] != nullptr) {
+    succ_prev = succ;
+    succ = succ->child[0];
+  }
+
+  auto node = new TreeNode<T>(succ->value, curr->child[0], curr->child[1]);
+
+  if (succ_prev == curr) {
+    node->child[1] = succ->child[1];
+    prev->child[dir] = node;
+  }
+  else {
+    prev->child[dir] = node;
+
+    /* readers that went past curr before the swap may be still looking for
+       the successor's value in the right subtree */
+    synchronize_rcu();
+    succ_prev->child[0] = succ->child[1];
+  }
+
+  lock.unlock();
+  free_later(curr);
+  free_later(succ);
+  return true;
+}
+
+template <class T>
+bool Tree<T>::contains(const T value)
+{
+  rcu_read_lock();
+  auto node = root_->child[0];
+
+  while (node != nullptr && node->value != value) {
+    node = node->child[value > node->value];
+  }
+
+  rcu_read_unlock();
+  return node != nullptr;
+}
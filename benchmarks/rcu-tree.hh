@@ -0,0 +1,48 @@
+#ifndef RCU_TREE_HH
+#define RCU_TREE_HH
+
+#include <urcu.h>
+#include <array>
+#include <mutex>
+
+namespace rcu {
+
+template <class T>
+struct TreeNode {
+  T value;
+  std::array<TreeNode<T>*, 2> child;
+
+  TreeNode(const T v = {}, TreeNode<T>* left = nullptr,
+           TreeNode<T>* right = nullptr)
+      : value(v), child{left, right}
+  {
+  }
+};
+
+template <class T>
+class Tree {
+public:
+  using NodePtr = TreeNode<T>*;
+
+private:
+  NodePtr root_{nullptr};
+  std::mutex write_mutex_{};
+
+  void free_later(NodePtr node);
+
+public:
+  Tree();
+  Tree(const size_t n, const T min, const T max);
+
+  bool add(const T value);
+  bool erase(const T value);
+  bool contains(const T value);
+
+  NodePtr root() { return root_; }
+};
+
+template class Tree<int32_t>;
+
+}  // namespace rcu
+
+#endif /* RCU_TREE_HH */
@@ -0,0 +1,217 @@
+#include "topology.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace std;
+
+namespace {
+
+/* parses a list like "0-3,8,10-11" */
+vector<unsigned> parse_cpu_list(const string& list)
+{
+  vector<unsigned> result;
+  stringstream ss{list};
+
+  for (string range; getline(ss, range, ',');) {
+    if (range.empty() || range == "\n") continue;
+
+    const auto dash = range.find('-');
+    const unsigned first = stoul(range.substr(0, dash));
+    const unsigned last =
+        (dash == string::npos) ? first : stoul(range.substr(dash + 1));
+
+    if (last < first) throw runtime_error("invalid cpu list: " + list);
+    for (unsigned cpu = first; cpu <= last; cpu++) result.push_back(cpu);
+  }
+
+  return result;
+}
+
+bool read_file(const string& path, string& content)
+{
+  ifstream fin{path};
+  if (!fin) return false;
+
+  getline(fin, content);
+  return true;
+}
+
+unsigned read_number(const string& path, const unsigned fallback)
+{
+  string content;
+  return read_file(path, content) ? stoul(content) : fallback;
+}
+
+/* the NUMA node is the `nodeN` entry in the cpu's sysfs directory */
+unsigned node_of(const unsigned cpu)
+{
+  const string path = "/sys/devices/system/cpu/cpu" + to_string(cpu);
+  unsigned node = 0;
+
+  if (auto dir = opendir(path.c_str())) {
+    while (auto entry = readdir(dir)) {
+      const string name = entry->d_name;
+
+      if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+          all_of(name.begin() + 4, name.end(), ::isdigit)) {
+        node = stoul(name.substr(4));
+        break;
+      }
+    }
+
+    closedir(dir);
+  }
+
+  return node;
+}
+
+template <class Fn>
+string join(const vector<Topology::Cpu>& order, const size_t n, Fn&& field)
+{
+  string result;
+
+  for (size_t i = 0; i < n && !order.empty(); i++) {
+    if (i) result += ';';
+    result += to_string(field(order[i % order.size()]));
+  }
+
+  return result;
+}
+
+}  // namespace
+
+Topology::Topology()
+{
+  string online;
+  vector<unsigned> ids;
+
+  if (read_file("/sys/devices/system/cpu/online", online)) {
+    ids = parse_cpu_list(online);
+  }
+  else {
+    for (unsigned i = 0; i < thread::hardware_concurrency(); i++) {
+      ids.push_back(i);
+    }
+  }
+
+  for (const auto id : ids) {
+    const string base =
+        "/sys/devices/system/cpu/cpu" + to_string(id) + "/topology/";
+
+    cpus_.push_back({id, read_number(base + "core_id", id),
+                     read_number(base + "physical_package_id", 0),
+                     node_of(id)});
+  }
+}
+
+void Topology::set_affinity(const string& spec)
+{
+  order_.clear();
+
+  if (spec == "none") {
+    policy_ = Policy::None;
+  }
+  else if (spec == "compact") {
+    policy_ = Policy::Compact;
+    order_ = cpus_;
+
+    sort(order_.begin(), order_.end(), [](const Cpu& a, const Cpu& b) {
+      return tie(a.package, a.core, a.id) < tie(b.package, b.core, b.id);
+    });
+  }
+  else if (spec == "scatter") {
+    policy_ = Policy::Scatter;
+
+    /* ranking every cpu among its siblings, and every core in its package */
+    map<pair<unsigned, unsigned>, unsigned> siblings;
+    map<pair<unsigned, unsigned>, unsigned> core_rank;
+    map<unsigned, unsigned> cores_in_package;
+    vector<tuple<unsigned, unsigned, unsigned, Cpu>> ranked;
+
+    auto sorted = cpus_;
+    sort(sorted.begin(), sorted.end(), [](const Cpu& a, const Cpu& b) {
+      return tie(a.package, a.core, a.id) < tie(b.package, b.core, b.id);
+    });
+
+    for (const auto& cpu : sorted) {
+      const auto core = make_pair(cpu.package, cpu.core);
+
+      if (!core_rank.count(core)) {
+        core_rank[core] = cores_in_package[cpu.package]++;
+      }
+
+      ranked.emplace_back(siblings[core]++, core_rank[core], cpu.package, cpu);
+    }
+
+    sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+      return tie(get<0>(a), get<1>(a), get<2>(a)) <
+             tie(get<0>(b), get<1>(b), get<2>(b));
+    });
+
+    for (const auto& entry : ranked) order_.push_back(get<3>(entry));
+  }
+  else {
+    policy_ = Policy::List;
+
+    for (const auto id : parse_cpu_list(spec)) {
+      const auto cpu =
+          find_if(cpus_.begin(), cpus_.end(),
+                  [id](const Cpu& c) { return c.id == id; });
+
+      if (cpu == cpus_.end()) {
+        throw runtime_error("cpu " + to_string(id) + " is not online");
+      }
+
+      order_.push_back(*cpu);
+    }
+
+    if (order_.empty()) throw runtime_error("empty cpu list");
+  }
+}
+
+bool Topology::pin(const size_t thread_index) const
+{
+  if (order_.empty()) return false;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(order_[thread_index % order_.size()].id, &set);
+
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    throw runtime_error("could not pin the thread");
+  }
+
+  return true;
+}
+
+string Topology::policy_name() const
+{
+  switch (policy_) {
+  case Policy::None: return "none";
+  case Policy::Compact: return "compact";
+  case Policy::Scatter: return "scatter";
+  case Policy::List: return "list";
+  }
+
+  return "";
+}
+
+string Topology::cpus(const size_t n_threads) const
+{
+  return join(order_, n_threads, [](const Cpu& cpu) { return cpu.id; });
+}
+
+string Topology::nodes(const size_t n_threads) const
+{
+  return join(order_, n_threads, [](const Cpu& cpu) { return cpu.node; });
+}
@@ -0,0 +1,49 @@
+#ifndef TOPOLOGY_HH
+#define TOPOLOGY_HH
+
+#include <string>
+#include <vector>
+
+/*
+ * The machine's CPUs, as sysfs describes them, and the order in which the
+ * benchmark threads are pinned to them.
+ */
+class Topology {
+public:
+  struct Cpu {
+    unsigned id;
+    unsigned core;     // core_id, unique within a package
+    unsigned package;  // physical_package_id
+    unsigned node;     // NUMA node
+  };
+
+  /* `none` leaves the placement to the OS; `compact` fills the SMT siblings
+     of a core, then the cores of a package, then the next package; `scatter`
+     goes round-robin over the packages, then the cores, using the siblings
+     last; a list ("0,2,8-11") pins the threads to those CPUs, in order */
+  enum class Policy { None, Compact, Scatter, List };
+
+private:
+  std::vector<Cpu> cpus_{};  // the online ones, by id
+  Policy policy_{Policy::None};
+  std::vector<Cpu> order_{};  // thread i runs on order_[i % size]
+
+public:
+  Topology();
+
+  /* parses "none", "compact", "scatter" or a CPU list */
+  void set_affinity(const std::string& spec);
+
+  Policy policy() const { return policy_; }
+
+  /* pins the calling thread to its CPU; returns false under `none` */
+  bool pin(const size_t thread_index) const;
+
+  /* the policy, the CPUs and the NUMA nodes the first `n_threads` threads
+     use, e.g. "compact", "0;1;2;3" and "0;0;0;0" */
+  std::string policy_name() const;
+  std::string cpus(const size_t n_threads) const;
+  std::string nodes(const size_t n_threads) const;
+};
+
+#endif /* TOPOLOGY_HH */
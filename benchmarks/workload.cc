@@ -0,0 +1,208 @@
+#include "workload.hh"
+
+#include <cmath>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+vector<string> split(const string& spec)
+{
+  vector<string> parts;
+  stringstream ss{spec};
+
+  for (string part; getline(ss, part, ':');) parts.push_back(part);
+  return parts;
+}
+
+double zeta(const uint64_t n, const double theta)
+{
+  double sum = 0;
+  for (uint64_t i = 1; i <= n; i++) sum += 1 / pow(i, theta);
+  return sum;
+}
+
+uint64_t splitmix64(uint64_t& x)
+{
+  uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+}  // namespace
+
+void Workload::Config::set_mix(const string& spec)
+{
+  const auto parts = split(spec);
+
+  if (parts.size() < 3 || parts.size() > 4) {
+    throw runtime_error("mix must be ADD:ERASE:CONTAINS[:SCAN]");
+  }
+
+  mix = {0, 0, 0, 0};
+
+  for (size_t i = 0; i < parts.size(); i++) {
+    mix[i] = stod(parts[i]);
+    if (mix[i] < 0) throw runtime_error("mix weights can't be negative");
+  }
+
+  if (mix[0] + mix[1] + mix[2] + mix[3] <= 0) {
+    throw runtime_error("mix must have a positive weight");
+  }
+}
+
+void Workload::Config::set_distribution(const string& spec)
+{
+  const auto parts = split(spec);
+
+  if (parts[0] == "uniform" && parts.size() == 1) {
+    distribution = Distribution::Uniform;
+  }
+  else if (parts[0] == "zipf" && parts.size() <= 2) {
+    distribution = Distribution::Zipf;
+    if (parts.size() == 2) zipf_theta = stod(parts[1]);
+  }
+  else if (parts[0] == "hotspot" && (parts.size() == 1 || parts.size() == 3)) {
+    distribution = Distribution::Hotspot;
+
+    if (parts.size() == 3) {
+      hot_keys = stod(parts[1]);
+      hot_ops = stod(parts[2]);
+    }
+  }
+  else {
+    throw runtime_error("unknown distribution: " + spec);
+  }
+}
+
+Workload::Workload(const Config& config)
+    : config_(config),
+      key_count_(static_cast<int64_t>(config.max_value) - config.min_value + 1)
+{
+  double total = 0;
+  for (const auto weight : config_.mix) total += weight;
+
+  double sum = 0;
+  for (size_t i = 0; i < op_thresholds_.size(); i++) {
+    sum += config_.mix[i];
+    op_thresholds_[i] = static_cast<uint64_t>(sum / total * 0x1.0p32);
+  }
+
+  op_thresholds_.back() = 1ull << 32;  // no rounding leftovers
+
+  /* Knuth's multiplicative hash constant, a prime */
+  scramble_ = 2654435761ull % key_count_;
+  while (gcd(scramble_, key_count_) != 1) scramble_++;
+
+  switch (config_.distribution) {
+  case Distribution::Uniform: break;
+
+  case Distribution::Zipf: {
+    const double theta = config_.zipf_theta;
+
+    if (theta <= 0 || theta == 1) {
+      throw runtime_error("zipf theta must be positive and not 1");
+    }
+
+    zipf_zeta2_ = zeta(2, theta);
+    zipf_zetan_ = zeta(key_count_, theta);
+    zipf_alpha_ = 1 / (1 - theta);
+    zipf_eta_ = (1 - pow(2.0 / key_count_, 1 - theta)) /
+                (1 - zipf_zeta2_ / zipf_zetan_);
+    break;
+  }
+
+  case Distribution::Hotspot:
+    if (config_.hot_keys <= 0 || config_.hot_keys > 1 || config_.hot_ops < 0 ||
+        config_.hot_ops > 1) {
+      throw runtime_error("hotspot fractions must be in (0, 1]");
+    }
+
+    hot_count_ = max<uint64_t>(1, config_.hot_keys * key_count_);
+    hot_threshold_ = static_cast<uint64_t>(config_.hot_ops * 0x1.0p32);
+    break;
+  }
+}
+
+Workload::Generator::Generator(const Workload& workload, uint64_t seed)
+    : workload_(workload)
+{
+  for (auto& s : state_) s = splitmix64(seed);
+}
+
+uint64_t Workload::Generator::next_u64()
+{
+  /* xoshiro256** (Blackman & Vigna) */
+  const auto rotl = [](const uint64_t x, const int k) {
+    return (x << k) | (x >> (64 - k));
+  };
+
+  const uint64_t result = rotl(state_[1] * 5, 7) * 9;
+  const uint64_t t = state_[1] << 17;
+
+  state_[2] ^= state_[0];
+  state_[3] ^= state_[1];
+  state_[1] ^= state_[2];
+  state_[0] ^= state_[3];
+  state_[2] ^= t;
+  state_[3] = rotl(state_[3], 45);
+
+  return result;
+}
+
+uint64_t Workload::Generator::next_rank()
+{
+  const auto& w = workload_;
+
+  switch (w.config_.distribution) {
+  case Distribution::Uniform: return next_below(w.key_count_);
+
+  case Distribution::Zipf: {
+    const double u = next_double();
+    const double uz = u * w.zipf_zetan_;
+
+    if (uz < 1) return 0;
+    if (uz < w.zipf_zeta2_) return 1;
+
+    const auto rank = static_cast<uint64_t>(
+        w.key_count_ * pow(w.zipf_eta_ * u - w.zipf_eta_ + 1, w.zipf_alpha_));
+    return min(rank, w.key_count_ - 1);
+  }
+
+  case Distribution::Hotspot:
+    if ((next_u64() >> 32) < w.hot_threshold_) {
+      return next_below(w.hot_count_);
+    }
+    else if (w.hot_count_ < w.key_count_) {
+      return w.hot_count_ + next_below(w.key_count_ - w.hot_count_);
+    }
+    else {
+      return next_below(w.key_count_);
+    }
+  }
+
+  return 0;
+}
+
+Workload::Request Workload::Generator::next()
+{
+  const uint64_t draw = next_u64() >> 32;
+  size_t op = 0;
+
+  while (draw >= workload_.op_thresholds_[op]) op++;
+
+  const auto& w = workload_;
+  uint64_t rank = next_rank();
+
+  if (w.config_.distribution != Distribution::Uniform) {
+    rank = (rank + 1) * w.scramble_ % w.key_count_;
+  }
+
+  return {static_cast<Op>(op),
+          static_cast<int32_t>(w.config_.min_value + rank)};
+}
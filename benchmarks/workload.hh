@@ -0,0 +1,99 @@
+#ifndef WORKLOAD_HH
+#define WORKLOAD_HH
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/*
+ * The operations a benchmark thread runs, and the keys it runs them on. The
+ * shared `Workload` holds everything that can be precomputed (the op mix as
+ * thresholds, the Zipf constants); every thread draws from its own
+ * `Generator`, which is a xoshiro256** PRNG and costs a few nanoseconds per
+ * operation.
+ */
+class Workload {
+public:
+  enum class Op { Add, Erase, Contains, Scan };
+  enum class Distribution { Uniform, Zipf, Hotspot };
+
+  struct Config {
+    int32_t min_value = -1024;
+    int32_t max_value = 1023;
+
+    /* weights of add, erase, contains and scan */
+    std::array<double, 4> mix{0.01, 0.01, 0.98, 0};
+    size_t scan_length = 64;  // keys covered by a scan
+
+    Distribution distribution = Distribution::Uniform;
+    double zipf_theta = 0.99;
+    double hot_keys = 0.1;  // fraction of the keys that are hot...
+    double hot_ops = 0.9;   // ...and the fraction of the ops that hit them
+
+    /* parses "add:erase:contains:scan" */
+    void set_mix(const std::string& spec);
+
+    /* parses "uniform", "zipf[:THETA]" or "hotspot[:KEYS:OPS]" */
+    void set_distribution(const std::string& spec);
+  };
+
+  struct Request {
+    Op op;
+    int32_t key;
+  };
+
+  class Generator {
+  private:
+    const Workload& workload_;
+    std::array<uint64_t, 4> state_{};
+
+    uint64_t next_u64();
+
+    /* uniform in [0, 1) */
+    double next_double() { return (next_u64() >> 11) * 0x1.0p-53; }
+
+    /* uniform in [0, n), for n <= 2^32 */
+    uint64_t next_below(const uint64_t n)
+    {
+      return ((next_u64() >> 32) * n) >> 32;
+    }
+
+    uint64_t next_rank();
+
+  public:
+    Generator(const Workload& workload, uint64_t seed);
+
+    Request next();
+  };
+
+private:
+  const Config config_;
+  const uint64_t key_count_;
+
+  /* `Op` of a request is the first one whose threshold is above the draw */
+  std::array<uint64_t, 4> op_thresholds_{};
+
+  /* Zipf constants, as in Gray et al., "Quickly Generating Billion-Record
+     Synthetic Databases" (SIGMOD'94) */
+  double zipf_alpha_{0};
+  double zipf_eta_{0};
+  double zipf_zeta2_{0};
+  double zipf_zetan_{0};
+
+  uint64_t hot_count_{0};
+  uint64_t hot_threshold_{0};
+
+  /* the skewed ranks are spread over the key range, key = (rank + 1) *
+     `scramble_` mod `key_count_`, so that the hot keys aren't all at the
+     front of a list or down one side of a tree; it's a permutation, as
+     `scramble_` and `key_count_` are coprime */
+  uint64_t scramble_{1};
+
+public:
+  Workload(const Config& config);
+
+  const Config& config() const { return config_; }
+  bool has_scans() const { return config_.mix[3] > 0; }
+};
+
+#endif /* WORKLOAD_HH */
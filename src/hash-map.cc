@@ -0,0 +1,366 @@
+#include "hash-map.hh"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+
+using namespace std;
+using namespace rlu;
+
+template <class K, class V>
+size_t HashMap<K, V>::bucket_of(const K key, const size_t size)
+{
+  // a murmur3 finalizer, so that dense integer keys spread over the buckets
+  uint64_t h = hash<K>{}(key);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+
+  return h & (size - 1);
+}
+
+template <class K, class V>
+typename HashMap<K, V>::BucketPtr* HashMap<K, V>::make_buckets(
+    const size_t size)
+{
+  if (size == 0 || (size & (size - 1)) != 0) {
+    throw runtime_error("bucket count must be a power of two");
+  }
+
+  auto buckets = new BucketPtr[size];
+  for (size_t i = 0; i < size; i++) {
+    buckets[i] = mem::alloc<HashBucket<K, V>>();
+  }
+
+  return buckets;
+}
+
+template <class K, class V>
+HashMap<K, V>::HashMap(const size_t n_buckets)
+{
+  table_ = mem::alloc<HashTable<K, V>>(n_buckets, make_buckets(n_buckets));
+  grow_at_ = n_buckets * MAX_LOAD_FACTOR;
+}
+
+/*
+ * frees all the nodes (not thread-safe)
+ */
+template <class K, class V>
+HashMap<K, V>::~HashMap()
+{
+  for (size_t i = 0; i < table_->size; i++) {
+    for (auto node = table_->buckets[i]->head; node != nullptr;) {
+      auto next = node->next;
+      mem::free(node);
+      node = next;
+    }
+
+    mem::free(table_->buckets[i]);
+  }
+
+  delete[] table_->buckets;
+  mem::free(table_);
+}
+
+template <class K, class V>
+size_t HashMap<K, V>::bucket_count(context::Thread& thread_ctx)
+{
+  thread_ctx.reader_lock();
+  const size_t size = thread_ctx.dereference(table_)->size;
+  thread_ctx.reader_unlock();
+  return size;
+}
+
+/*
+ * writers stay out of the table while it's being resized, so that the
+ * resizing thread can eventually lock all the buckets
+ */
+template <class K, class V>
+void HashMap<K, V>::wait_for_resize(context::Thread& thread_ctx)
+{
+  if (!resizing_) return;
+
+  thread_ctx.flush();  // the resizer might be waiting for our deferred locks
+  while (resizing_) this_thread::yield();
+}
+
+template <class K, class V>
+void HashMap<K, V>::grow(context::Thread& thread_ctx)
+{
+  const size_t n_buckets = bucket_count(thread_ctx);
+
+  if (count_ > n_buckets * MAX_LOAD_FACTOR) {
+    resize(thread_ctx, n_buckets * 2);
+  }
+}
+
+template <class K, class V>
+bool HashMap<K, V>::insert(context::Thread& thread_ctx, const K key,
+                           const V value)
+{
+restart:
+  wait_for_resize(thread_ctx);
+
+  bool inserted = false;
+  thread_ctx.reader_lock();
+
+  auto table = thread_ctx.dereference(table_);
+  auto bucket = thread_ctx.dereference(
+      table->buckets[bucket_of(key, table->size)]);
+
+  NodePtr prev = nullptr;
+  NodePtr next = thread_ctx.dereference(bucket->head);
+
+  while (next != nullptr && next->key < key) {
+    prev = next;
+    next = thread_ctx.dereference(prev->next);
+  }
+
+  if (next == nullptr || next->key != key) {
+    /* every writer locks the bucket; that's what keeps it out of the way of a
+       concurrent resize */
+    if (!thread_ctx.try_lock(bucket) ||
+        (prev != nullptr && !thread_ctx.try_lock(prev))) {
+      thread_ctx.abort();
+      goto restart;
+    }
+
+    auto node = mem::alloc<HashNode<K, V>>(key, value);
+    thread_ctx.assign(node->next, next);
+
+    if (prev != nullptr) {
+      thread_ctx.assign(prev->next, node);
+    }
+    else {
+      thread_ctx.assign(bucket->head, node);
+    }
+
+    inserted = true;
+  }
+
+  thread_ctx.reader_unlock();
+
+  if (inserted && ++count_ > grow_at_) {
+    grow(thread_ctx);
+  }
+
+  return inserted;
+}
+
+template <class K, class V>
+bool HashMap<K, V>::erase(context::Thread& thread_ctx, const K key)
+{
+restart:
+  wait_for_resize(thread_ctx);
+
+  bool found = false;
+  thread_ctx.reader_lock();
+
+  auto table = thread_ctx.dereference(table_);
+  auto bucket = thread_ctx.dereference(
+      table->buckets[bucket_of(key, table->size)]);
+
+  NodePtr prev = nullptr;
+  NodePtr next = thread_ctx.dereference(bucket->head);
+
+  while (next != nullptr && next->key < key) {
+    prev = next;
+    next = thread_ctx.dereference(prev->next);
+  }
+
+  if (next != nullptr && next->key == key) {
+    if (!thread_ctx.try_lock(bucket) ||
+        (prev != nullptr && !thread_ctx.try_lock(prev))) {
+      thread_ctx.abort();
+      goto restart;
+    }
+
+    auto node = thread_ctx.dereference(next->next);
+
+    if (prev != nullptr) {
+      thread_ctx.assign(prev->next, node);
+    }
+    else {
+      thread_ctx.assign(bucket->head, node);
+    }
+
+    mem::retire(thread_ctx, next);
+    found = true;
+  }
+
+  thread_ctx.reader_unlock();
+
+  if (found) count_--;
+  return found;
+}
+
+template <class K, class V>
+bool HashMap<K, V>::find(context::Thread& thread_ctx, const K key, V& value)
+{
+  thread_ctx.reader_lock();
+
+  auto table = thread_ctx.dereference(table_);
+  auto bucket = thread_ctx.dereference(
+      table->buckets[bucket_of(key, table->size)]);
+  NodePtr node = thread_ctx.dereference(bucket->head);
+
+  while (node != nullptr && node->key < key) {
+    node = thread_ctx.dereference(node->next);
+  }
+
+  const bool found = (node != nullptr && node->key == key);
+  if (found) value = node->value;
+
+  thread_ctx.reader_unlock();
+  return found;
+}
+
+template <class K, class V>
+bool HashMap<K, V>::contains(context::Thread& thread_ctx, const K key)
+{
+  V value{};
+  return find(thread_ctx, key, value);
+}
+
+/*
+ * The resize is a single RLU write section: it locks the table and every
+ * bucket, builds the new chains out of fresh copies of the nodes and swaps the
+ * bucket array in the table's copy. Readers that started before the commit
+ * keep walking the old chains, which are retired after the grace period.
+ */
+template <class K, class V>
+void HashMap<K, V>::resize(context::Thread& thread_ctx, const size_t n_buckets)
+{
+  bool expected = false;
+  while (!resizing_.compare_exchange_weak(expected, true)) {
+    if (expected) return;  // someone else is already resizing
+  }
+
+restart:
+  thread_ctx.reader_lock();
+
+  auto table = thread_ctx.dereference(table_);
+
+  if (table->size == n_buckets) {
+    thread_ctx.reader_unlock();
+    resizing_ = false;
+    return;
+  }
+
+  if (!thread_ctx.try_lock(table)) {
+    thread_ctx.abort();
+    goto restart;
+  }
+
+  for (size_t i = 0; i < table->size; i++) {
+    auto bucket = table->buckets[i];
+
+    if (!thread_ctx.try_lock(bucket)) {
+      thread_ctx.abort();
+      goto restart;
+    }
+  }
+
+  auto buckets = make_buckets(n_buckets);
+
+  for (size_t i = 0; i < table->size; i++) {
+    auto bucket = thread_ctx.dereference(table->buckets[i]);
+
+    for (auto node = thread_ctx.dereference(bucket->head); node != nullptr;
+         node = thread_ctx.dereference(node->next)) {
+      // the new buckets aren't reachable yet, so they're written in place
+      auto& head = buckets[bucket_of(node->key, n_buckets)]->head;
+      auto pos = &head;
+      while (*pos != nullptr && (*pos)->key < node->key) pos = &(*pos)->next;
+
+      *pos = mem::alloc<HashNode<K, V>>(node->key, node->value, *pos);
+      mem::retire(thread_ctx, node);
+    }
+
+    mem::retire(thread_ctx, table->buckets[i]);
+  }
+
+  thread_ctx.retire(table->buckets, [](Pointer ptr) {
+    delete[] reinterpret_cast<BucketPtr*>(ptr);
+  });
+
+  table->size = n_buckets;
+  table->buckets = buckets;
+
+  thread_ctx.reader_unlock();
+
+  grow_at_ = n_buckets * MAX_LOAD_FACTOR;
+  resizing_ = false;
+}
+
+template <class K, class V>
+bool HashMap<K, V>::insert_unsafe(const K key, const V value)
+{
+  auto pos = &table_->buckets[bucket_of(key, table_->size)]->head;
+  while (*pos != nullptr && (*pos)->key < key) pos = &(*pos)->next;
+
+  if (*pos != nullptr && (*pos)->key == key) return false;
+
+  *pos = mem::alloc<HashNode<K, V>>(key, value, *pos);
+  count_++;
+  return true;
+}
+
+template <class K>
+HashSet<K>::HashSet(const size_t n_buckets) : map_(n_buckets)
+{
+}
+
+/*
+ * creates a set with `n` random numbers (not thread-safe)
+ */
+template <class K>
+HashSet<K>::HashSet(const size_t n, const K min, const K max)
+    : map_([n] {
+        size_t n_buckets = 1;
+        while (n_buckets < n) n_buckets *= 2;
+        return std::max(n_buckets, HashMap<K, Empty>::DEFAULT_BUCKETS);
+      }())
+{
+  random_device dev;
+  mt19937 rng{dev()};
+  uniform_int_distribution<K> distribution{min, max};
+
+  size_t count = 0;
+
+  while (count != n) {
+    count += map_.insert_unsafe(distribution(rng), {});
+  }
+}
+
+template <class K>
+size_t HashSet<K>::bucket_count(context::Thread& thread_ctx)
+{
+  return map_.bucket_count(thread_ctx);
+}
+
+template <class K>
+bool HashSet<K>::add(context::Thread& thread_ctx, const K value)
+{
+  return map_.insert(thread_ctx, value, {});
+}
+
+template <class K>
+bool HashSet<K>::erase(context::Thread& thread_ctx, const K value)
+{
+  return map_.erase(thread_ctx, value);
+}
+
+template <class K>
+bool HashSet<K>::contains(context::Thread& thread_ctx, const K value)
+{
+  return map_.contains(thread_ctx, value);
+}
+
+template <class K>
+void HashSet<K>::resize(context::Thread& thread_ctx, const size_t n_buckets)
+{
+  map_.resize(thread_ctx, n_buckets);
+}
@@ -0,0 +1,114 @@
+#ifndef HASH_MAP_HH
+#define HASH_MAP_HH
+
+#include <atomic>
+#include <functional>
+
+#include "rlu.hh"
+
+namespace rlu {
+
+template <class K, class V>
+struct HashNode {
+  K key;
+  V value;
+  HashNode<K, V>* next;
+
+  HashNode(const K k = {}, const V v = {}, HashNode<K, V>* next = nullptr)
+      : key(k), value(v), next(next)
+  {
+  }
+};
+
+/* every bucket is an RLU object of its own, so writers to different buckets
+   never conflict, but a resize can lock all of them at once */
+template <class K, class V>
+struct HashBucket {
+  HashNode<K, V>* head;
+
+  HashBucket(HashNode<K, V>* head = nullptr) : head(head) {}
+};
+
+template <class K, class V>
+struct HashTable {
+  size_t size;
+  HashBucket<K, V>** buckets;
+
+  HashTable(const size_t size = 0, HashBucket<K, V>** buckets = nullptr)
+      : size(size), buckets(buckets)
+  {
+  }
+};
+
+template <class K, class V>
+class HashMap {
+public:
+  using NodePtr = HashNode<K, V>*;
+  using BucketPtr = HashBucket<K, V>*;
+  using TablePtr = HashTable<K, V>*;
+
+  static constexpr size_t DEFAULT_BUCKETS = 1024;
+  static constexpr size_t MAX_LOAD_FACTOR = 2;
+
+private:
+  TablePtr table_{nullptr};
+
+  std::atomic<size_t> count_{0};
+  std::atomic<size_t> grow_at_{0};
+  std::atomic<bool> resizing_{false};
+
+  static size_t bucket_of(const K key, const size_t size);
+  static BucketPtr* make_buckets(const size_t size);
+
+  void wait_for_resize(context::Thread& thread_ctx);
+  void grow(context::Thread& thread_ctx);
+
+public:
+  HashMap(const size_t n_buckets = DEFAULT_BUCKETS);
+  ~HashMap();
+
+  HashMap(const HashMap<K, V>&) = delete;
+  HashMap<K, V>& operator=(const HashMap<K, V>&) = delete;
+
+  size_t size() const { return count_; }
+  size_t bucket_count(context::Thread& thread_ctx);
+
+  bool insert(context::Thread& thread_ctx, const K key, const V value);
+  bool erase(context::Thread& thread_ctx, const K key);
+  bool find(context::Thread& thread_ctx, const K key, V& value);
+  bool contains(context::Thread& thread_ctx, const K key);
+
+  /* rehashes the map into `n_buckets` buckets (a power of two). Readers are
+     never blocked; writers wait until the new table is committed. */
+  void resize(context::Thread& thread_ctx, const size_t n_buckets);
+
+  /* inserts without any synchronization (not thread-safe) */
+  bool insert_unsafe(const K key, const V value);
+};
+
+template <class K>
+class HashSet {
+private:
+  struct Empty {};
+  HashMap<K, Empty> map_;
+
+public:
+  HashSet(const size_t n_buckets = HashMap<K, Empty>::DEFAULT_BUCKETS);
+  HashSet(const size_t n, const K min, const K max);
+
+  size_t size() const { return map_.size(); }
+  size_t bucket_count(context::Thread& thread_ctx);
+
+  bool add(context::Thread& thread_ctx, const K value);
+  bool erase(context::Thread& thread_ctx, const K value);
+  bool contains(context::Thread& thread_ctx, const K value);
+
+  void resize(context::Thread& thread_ctx, const size_t n_buckets);
+};
+
+template class HashMap<int32_t, int32_t>;
+template class HashSet<int32_t>;
+
+}  // namespace rlu
+
+#endif /* HASH_MAP_HH */
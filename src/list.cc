@@ -1,10 +1,80 @@
 #include "list.hh"
 
+#include <algorithm>
+#include <array>
 #include <random>
+#include <stdexcept>
+#include <thread>
 
 using namespace std;
 using namespace rlu;
 
+namespace {
+
+/* below this, a chunk isn't worth a thread of its own */
+constexpr size_t MIN_SORT_CHUNK = 64 * 1024;
+
+/* sorts a chunk per core, and then merges the chunks pairwise, a round of
+   merges (in parallel, too) at a time */
+template <class T>
+void parallel_sort(vector<T>& values)
+{
+  const size_t chunks = max<size_t>(
+      1, min<size_t>(thread::hardware_concurrency(),
+                     values.size() / MIN_SORT_CHUNK));
+
+  vector<size_t> bounds;
+  for (size_t i = 0; i <= chunks; i++) {
+    bounds.push_back(values.size() * i / chunks);
+  }
+
+  const auto begin = values.begin();
+  vector<thread> threads;
+
+  for (size_t i = 0; i < chunks; i++) {
+    threads.emplace_back([&, i] {
+      sort(begin + bounds[i], begin + bounds[i + 1]);
+    });
+  }
+
+  for (auto& t : threads) t.join();
+
+  for (size_t width = 1; width < chunks; width *= 2) {
+    threads.clear();
+
+    for (size_t i = 0; i + width < chunks; i += 2 * width) {
+      threads.emplace_back([&, i, width] {
+        inplace_merge(begin + bounds[i], begin + bounds[i + width],
+                      begin + bounds[min(i + 2 * width, chunks)]);
+      });
+    }
+
+    for (auto& t : threads) t.join();
+  }
+}
+
+/* `n` distinct random values, sorted */
+template <class T>
+vector<T> random_values(const size_t n, const T min, const T max)
+{
+  random_device dev;
+  mt19937 rng{dev()};
+  uniform_int_distribution<T> distribution{min, max};
+
+  vector<T> values;
+
+  while (values.size() != n) {
+    while (values.size() != n) values.push_back(distribution(rng));
+
+    parallel_sort(values);
+    values.erase(unique(values.begin(), values.end()), values.end());
+  }
+
+  return values;
+}
+
+}  // namespace
+
 template <class T>
 List<T>::List()
 {
@@ -17,28 +87,25 @@ List<T>::List()
  * creates a list with `n` random numbers (not thread-safe)
  */
 template <class T>
-List<T>::List(const size_t n, const T min, const T max) : List()
+List<T>::List(const size_t n, const T min, const T max)
+    : List(random_values(n, min, max))
 {
-  random_device dev;
-  mt19937 rng{dev()};
-  uniform_int_distribution<T> distribution{min, max};
+}
 
-  size_t count = 0;
+template <class T>
+List<T>::List(vector<T> values) : List()
+{
+  if (!is_sorted(values.begin(), values.end())) parallel_sort(values);
 
-  while (count != n) {
-    const T candidate = distribution(rng);
-    auto prev = head_;
-    auto next = head_->next;
+  auto prev = head_;
+  const auto tail = head_->next;
 
-    while (next->value < candidate) {
-      prev = next;
-      next = prev->next;
-    }
+  for (const T value : values) {
+    if (value <= prev->value) continue;  // a duplicate (or the head's key)
+    if (value >= tail->value) break;     // the tail's key
 
-    if (next->value != candidate) {
-      count++;
-      prev->next = mem::alloc<Node<T>>(candidate, next);
-    }
+    prev->next = mem::alloc<Node<T>>(value, tail);
+    prev = prev->next;
   }
 }
 
@@ -78,10 +145,6 @@ restart:
 template <class T>
 bool List<T>::erase(context::Thread& thread_ctx, const T value)
 {
-  constexpr size_t TO_FREE_SIZE = 2048;
-  static thread_local NodePtr to_free[TO_FREE_SIZE];
-  static thread_local size_t tf_index = 0;
-
 restart:
   bool found = false;
   thread_ctx.reader_lock();
@@ -102,17 +165,11 @@ restart:
 
     auto node = thread_ctx.dereference(next->next);
     thread_ctx.assign(prev->next, node);
-    to_free[tf_index++] = next;
+    mem::retire(thread_ctx, next);
     found = true;
   }
 
   thread_ctx.reader_unlock();
-
-  if (tf_index >= TO_FREE_SIZE) {
-    for (size_t i = 0; i < tf_index; i++) mem::free(to_free[i]);
-    tf_index = 0;
-  }
-
   return found;
 }
 
@@ -130,3 +187,185 @@ bool List<T>::contains(context::Thread& thread_ctx, const T value)
   thread_ctx.reader_unlock();
   return (node != nullptr && node->value == value);
 }
+
+template <class T>
+size_t List<T>::add_batch(context::Thread& thread_ctx,
+                          const vector<T>& values)
+{
+  if (!is_sorted(values.begin(), values.end())) {
+    throw runtime_error("unsorted batch");
+  }
+
+  /* every insertion locks two nodes at most */
+  thread_ctx.reserve_write_log<Node<T>>(2 * values.size());
+
+  static thread_local vector<NodePtr> created;
+
+restart:
+  size_t added = 0;
+  created.clear();
+  thread_ctx.reader_lock();
+
+  auto prev = thread_ctx.dereference(head_);
+  auto next = thread_ctx.dereference(prev->next);
+
+  for (size_t i = 0; i < values.size(); i++) {
+    const T value = values[i];
+    if (i > 0 && value == values[i - 1]) continue;
+
+    while (next->value < value) {
+      prev = next;
+      next = thread_ctx.dereference(prev->next);
+    }
+
+    if (next->value == value) continue;
+
+    /* the node we've just created isn't reachable yet, and needs no lock */
+    const bool fresh = !created.empty() && prev == created.back();
+
+    if ((!fresh && !thread_ctx.try_lock(prev)) || !thread_ctx.try_lock(next)) {
+      thread_ctx.abort();
+      for (auto node : created) mem::free(node);
+      goto restart;
+    }
+
+    auto node = mem::alloc<Node<T>>(value);
+    created.push_back(node);
+    thread_ctx.assign(node->next, next);
+    thread_ctx.assign(prev->next, node);
+
+    prev = node;
+    added++;
+  }
+
+  thread_ctx.reader_unlock();
+  return added;
+}
+
+template <class T>
+size_t List<T>::erase_batch(context::Thread& thread_ctx,
+                            const vector<T>& values)
+{
+  if (!is_sorted(values.begin(), values.end())) {
+    throw runtime_error("unsorted batch");
+  }
+
+  thread_ctx.reserve_write_log<Node<T>>(2 * values.size());
+
+restart:
+  size_t erased = 0;
+  thread_ctx.reader_lock();
+
+  auto prev = thread_ctx.dereference(head_);
+  auto next = thread_ctx.dereference(prev->next);
+
+  for (const T value : values) {
+    while (next->value < value) {
+      prev = next;
+      next = thread_ctx.dereference(prev->next);
+    }
+
+    if (next->value != value || next->next == nullptr) continue;
+
+    if (!thread_ctx.try_lock(prev) || !thread_ctx.try_lock(next)) {
+      thread_ctx.abort();
+      goto restart;
+    }
+
+    auto node = thread_ctx.dereference(next->next);
+    thread_ctx.assign(prev->next, node);
+    mem::retire(thread_ctx, next);
+
+    next = node;  // `prev` stays, it's still the predecessor
+    erased++;
+  }
+
+  thread_ctx.reader_unlock();
+  return erased;
+}
+
+template <class T>
+size_t List<T>::contains_batch(context::Thread& thread_ctx,
+                               const vector<T>& values, vector<bool>& found)
+{
+  if (!is_sorted(values.begin(), values.end())) {
+    throw runtime_error("unsorted batch");
+  }
+
+  size_t count = 0;
+  found.assign(values.size(), false);
+  thread_ctx.reader_lock();
+
+  auto node = thread_ctx.dereference(thread_ctx.dereference(head_)->next);
+
+  for (size_t i = 0; i < values.size(); i++) {
+    while (node->value < values[i]) {
+      node = thread_ctx.dereference(node->next);
+    }
+
+    if (node->value == values[i]) {
+      found[i] = true;
+      count++;
+    }
+  }
+
+  thread_ctx.reader_unlock();
+  return count;
+}
+
+template <class T>
+size_t List<T>::contains_many(context::Thread& thread_ctx,
+                              const vector<T>& values, vector<bool>& found)
+{
+  struct Lookup {
+    size_t index;
+    NodePtr node;
+  };
+
+  array<Lookup, CONTAINS_WIDTH> lookups;
+  size_t active = 0;
+  size_t next = 0;  // the next value to start a lookup for
+  size_t count = 0;
+
+  found.assign(values.size(), false);
+  thread_ctx.reader_lock();
+
+  const auto first = thread_ctx.dereference(head_)->next;
+
+  for (; active < CONTAINS_WIDTH && next < values.size(); active++) {
+    lookups[active] = {next++, first};
+  }
+
+  __builtin_prefetch(util::object_header(first));
+
+  while (active > 0) {
+    for (size_t i = 0; i < active;) {
+      auto& lookup = lookups[i];
+      const auto node = thread_ctx.dereference(lookup.node);
+
+      if (node->value < values[lookup.index]) {
+        lookup.node = node->next;
+        __builtin_prefetch(util::object_header(lookup.node));
+        i++;
+        continue;
+      }
+
+      if (node->value == values[lookup.index]) {
+        found[lookup.index] = true;
+        count++;
+      }
+
+      /* the slot goes to the next value, or to the last active lookup */
+      if (next < values.size()) {
+        lookup = {next++, first};
+        i++;
+      }
+      else {
+        lookup = lookups[--active];
+      }
+    }
+  }
+
+  thread_ctx.reader_unlock();
+  return count;
+}
@@ -1,6 +1,9 @@
 #ifndef LIST_HH
 #define LIST_HH
 
+#include <limits>
+#include <vector>
+
 #include "rlu.hh"
 
 namespace rlu {
@@ -25,15 +28,80 @@ public:
   List();
   List(const size_t n, const T min, const T max);
 
+  /* links the nodes of `values` in a single pass, in key order, so that they
+     also sit in that order in the slabs; unsorted values are sorted first (in
+     parallel), and duplicates are dropped (not thread-safe) */
+  explicit List(std::vector<T> values);
+
   size_t len() const;
 
   bool add(context::Thread& thread_ctx, const T value);
   bool erase(context::Thread& thread_ctx, const T value);
   bool contains(context::Thread& thread_ctx, const T value);
 
+  /* the batch versions take sorted keys, and apply all of them in a single
+     section (and commit), with a single traversal; they return the number of
+     keys added, erased or found */
+  size_t add_batch(context::Thread& thread_ctx, const std::vector<T>& values);
+  size_t erase_batch(context::Thread& thread_ctx,
+                     const std::vector<T>& values);
+  size_t contains_batch(context::Thread& thread_ctx,
+                        const std::vector<T>& values, std::vector<bool>& found);
+
+  /* looks up unsorted keys in a single section, running `CONTAINS_WIDTH`
+     traversals at once, one hop each in turn, and prefetching every next
+     hop, so that their cache misses overlap (AMAC) */
+  static constexpr size_t CONTAINS_WIDTH = 8;
+
+  size_t contains_many(context::Thread& thread_ctx,
+                       const std::vector<T>& values, std::vector<bool>& found);
+
+  /* calls `fn(value)` on every value in [lo, hi], in order and within a
+     single read section; returns the number of visited values */
+  template <class Fn>
+  size_t for_each_range(context::Thread& thread_ctx, const T lo, const T hi,
+                        Fn&& fn);
+
+  template <class Fn>
+  size_t for_each(context::Thread& thread_ctx, Fn&& fn)
+  {
+    return for_each_range(thread_ctx, std::numeric_limits<T>::min(),
+                          std::numeric_limits<T>::max(), fn);
+  }
+
+  size_t count_range(context::Thread& thread_ctx, const T lo, const T hi)
+  {
+    return for_each_range(thread_ctx, lo, hi, [](const T) {});
+  }
+
   NodePtr head() { return head_; }
 };
 
+template <class T>
+template <class Fn>
+size_t List<T>::for_each_range(context::Thread& thread_ctx, const T lo,
+                               const T hi, Fn&& fn)
+{
+  size_t count = 0;
+  thread_ctx.reader_lock();
+
+  /* the head and the tail are sentinels, and never visited */
+  auto node = thread_ctx.dereference(thread_ctx.dereference(head_)->next);
+
+  while (node->next != nullptr && node->value < lo) {
+    node = thread_ctx.dereference(node->next);
+  }
+
+  for (; node->next != nullptr && node->value <= hi;
+       node = thread_ctx.dereference(node->next)) {
+    fn(node->value);
+    count++;
+  }
+
+  thread_ctx.reader_unlock();
+  return count;
+}
+
 template class List<int32_t>;
 
 }  // namespace rlu
@@ -0,0 +1,43 @@
+#include "numa.hh"
+
+#include <cstdint>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+/* from <numaif.h> */
+constexpr int MPOL_PREFERRED_ = 1;
+constexpr unsigned MPOL_MF_MOVE_ = 1 << 1;
+
+}  // namespace
+
+size_t rlu::numa::page_size()
+{
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+bool rlu::numa::current_node(unsigned& node)
+{
+  unsigned cpu = 0;
+  return syscall(SYS_getcpu, &cpu, &node, nullptr) == 0;
+}
+
+bool rlu::numa::bind_to_node(void* addr, const size_t len,
+                             const unsigned node)
+{
+  const auto page = page_size();
+  const auto start = reinterpret_cast<uintptr_t>(addr) & ~(page - 1);
+  const auto end = reinterpret_cast<uintptr_t>(addr) + len;
+
+  unsigned long mask[4] = {};  // enough for 256 nodes
+  if (node >= sizeof(mask) * 8) return false;
+  mask[node / 64] = 1ul << (node % 64);
+
+  return syscall(SYS_mbind, start, end - start, MPOL_PREFERRED_, mask,
+                 sizeof(mask) * 8, MPOL_MF_MOVE_) == 0;
+}
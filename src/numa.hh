@@ -0,0 +1,27 @@
+#ifndef NUMA_HH
+#define NUMA_HH
+
+#include <cstddef>
+
+namespace rlu {
+
+/*
+ * The little NUMA support we need, straight from the system calls, so we
+ * don't have to depend on libnuma.
+ */
+namespace numa {
+
+size_t page_size();
+
+/* the node the calling thread is running on */
+bool current_node(unsigned& node);
+
+/* asks the kernel to keep [addr, addr + len) on `node` (and move the pages
+   that are already elsewhere) */
+bool bind_to_node(void* addr, const size_t len, const unsigned node);
+
+}  // namespace numa
+
+}  // namespace rlu
+
+#endif /* NUMA_HH */
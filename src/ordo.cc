@@ -0,0 +1,135 @@
+#include "ordo.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+using namespace std;
+using namespace rlu;
+
+namespace {
+
+constexpr size_t ORDO_ROUNDS = 1000;
+
+void relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+bool pin_to(const unsigned cpu)
+{
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+/* the smallest difference between `to`'s clock and a timestamp `from` has
+   just sent it: `to`'s offset from `from`, plus the one-way latency */
+int64_t min_delta(const unsigned from, const unsigned to)
+{
+  atomic<uint64_t> round{0};  // odd while a timestamp is in flight
+  atomic<uint64_t> stamp{0};
+  atomic<bool> failed{false};
+  int64_t delta = numeric_limits<int64_t>::max();
+
+  thread sender{[&] {
+    if (!pin_to(from)) {
+      failed = true;
+      return;
+    }
+
+    for (uint64_t r = 0; r < 2 * ORDO_ROUNDS && !failed; r += 2) {
+      while (round.load(memory_order_acquire) != r && !failed) relax();
+
+      stamp.store(ordo::now(), memory_order_relaxed);
+      round.store(r + 1, memory_order_release);
+    }
+  }};
+
+  if (!pin_to(to)) failed = true;
+
+  for (uint64_t r = 0; r < 2 * ORDO_ROUNDS && !failed; r += 2) {
+    while (round.load(memory_order_acquire) != r + 1 && !failed) relax();
+
+    const auto received = ordo::now();
+    const auto sent = stamp.load(memory_order_relaxed);
+    delta = min(delta, static_cast<int64_t>(received - sent));
+
+    round.store(r + 2, memory_order_release);
+  }
+
+  sender.join();
+
+  /* a core we can't run on doesn't matter */
+  return failed ? 0 : delta;
+}
+
+uint64_t measure_boundary()
+{
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return 0;
+
+  vector<unsigned> cpus;
+  for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+  }
+
+  /* measuring every core against the first one only is linear, and still an
+     upper bound: |off(i) - off(j)| <= (off(i) - off(0)) + (off(0) - off(j)) */
+  int64_t ahead = 0;
+  int64_t behind = 0;
+
+  for (size_t i = 1; i < cpus.size(); i++) {
+    ahead = max(ahead, min_delta(cpus[0], cpus[i]));
+    behind = max(behind, min_delta(cpus[i], cpus[0]));
+  }
+
+  return ahead + behind;
+}
+
+}  // namespace
+
+bool ordo::available()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int eax, ebx, ecx, edx;
+
+  /* CPUID.80000007H:EDX[8] is the invariant TSC bit */
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+  return (edx & (1 << 8)) != 0;
+#else
+  return false;
+#endif
+}
+
+uint64_t ordo::boundary()
+{
+  /* on a thread of its own, so the caller's affinity is left alone */
+  static const uint64_t boundary = [] {
+    uint64_t result = 0;
+    thread{[&result] { result = measure_boundary(); }}.join();
+    return result;
+  }();
+
+  return boundary;
+}
+
+void ordo::wait_until_past(const uint64_t time)
+{
+  const uint64_t target = time + boundary();
+  while (now() <= target) relax();
+}
@@ -0,0 +1,43 @@
+#ifndef ORDO_HH
+#define ORDO_HH
+
+#include <chrono>
+#include <cstdint>
+
+namespace rlu {
+
+/*
+ * A global clock made of the cores' own invariant TSCs, after ORDO (Kashyap
+ * et al., "A Scalable Ordering Primitive for Multicore Machines", EuroSys'18).
+ * The TSCs tick at the same rate but aren't perfectly in sync, so two
+ * timestamps are only ordered if they're more than `boundary()` apart.
+ */
+namespace ordo {
+
+/* whether the TSC is invariant (constant rate, never stops); the clock must
+   not be used without it */
+bool available();
+
+/* the calling core's TSC, read after every earlier instruction is done */
+inline uint64_t now()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int aux;
+  return __builtin_ia32_rdtscp(&aux);
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+/* the largest offset between any two cores' TSCs, plus the time it takes to
+   tell; it's measured on the first call, which can take a while */
+uint64_t boundary();
+
+/* spins until every core's clock is past `time` */
+void wait_until_past(const uint64_t time);
+
+}  // namespace ordo
+
+}  // namespace rlu
+
+#endif /* ORDO_HH */
@@ -3,118 +3,808 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <new>
 #include <stdexcept>
+#include <thread>
+
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "numa.hh"
 
 using namespace std;
 using namespace rlu;
 using namespace rlu::context;
 
-Thread::Thread(const size_t thread_id, Global& global_context)
-    : thread_id_(thread_id), global_ctx_(global_context)
+namespace {
+
+/* the futex of a thread's section is the low half of its run count, which
+   changes with every section boundary */
+uint32_t* futex_word(atomic<uint64_t>& run_count)
+{
+  static_assert(sizeof(run_count) == sizeof(uint64_t), "unexpected layout");
+
+  return reinterpret_cast<uint32_t*>(&run_count) +
+         (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ ? 1 : 0);
+}
+
+/* the reader's check for sleepers isn't ordered after its run count store,
+   so a wake-up can be missed; the timeout puts a bound on that */
+constexpr timespec SYNC_SLEEP_TIMEOUT{0, 1000 * 1000};
+
+void futex_wait(uint32_t* word, const uint32_t expected)
+{
+  syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, &SYNC_SLEEP_TIMEOUT,
+          nullptr, 0);
+}
+
+void futex_wake(uint32_t* word)
+{
+  syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+}  // namespace
+
+Global::Global(const bool numa_local, const ClockSource clock_source)
+    : numa_local_(numa_local),
+      clock_source_(clock_source),
+      state_stride_(numa_local
+                        ? max(numa::page_size(), sizeof(ThreadState))
+                        : sizeof(ThreadState))
+{
+  void* states =
+      mmap(nullptr, MAX_THREADS * state_stride_, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (states == MAP_FAILED) {
+    throw runtime_error("could not allocate the thread states");
+  }
+
+  states_ = reinterpret_cast<uint8_t*>(states);
+
+  if (clock_source_ == ClockSource::Ordo) {
+    if (!ordo::available()) {
+      munmap(states_, MAX_THREADS * state_stride_);
+      throw runtime_error("the ORDO clock needs an invariant TSC");
+    }
+
+    ordo::boundary();  // measured now rather than in the first commit
+  }
+
+  /* the states outlive their threads: a run count must never go back, or a
+     writer that sampled it before the slot was reused could be confused */
+  for (size_t i = 0; i < MAX_THREADS; i++) {
+    new (&state(i)) ThreadState{};
+  }
+}
+
+Global::~Global()
+{
+  {
+    lock_guard<mutex> guard{commit_lock_};
+    stopping_ = true;
+  }
+
+  commit_ready_.notify_one();
+  if (committer_.joinable()) committer_.join();
+
+  for (auto& thread : threads_) thread.reset();
+  munmap(states_, MAX_THREADS * state_stride_);
+}
+
+size_t Global::claim_slot()
+{
+  for (size_t w = 0; w < BITMAP_WORDS; w++) {
+    uint64_t word = claimed_[w].load();
+
+    while (~word != 0) {
+      const size_t bit = __builtin_ctzll(~word);
+      const size_t id = w * 64 + bit;
+      if (id >= MAX_THREADS) break;
+
+      if (claimed_[w].compare_exchange_weak(word, word | (1ull << bit))) {
+        return id;
+      }
+      // `word` was reloaded
+    }
+  }
+
+  throw runtime_error("too many threads");
+}
+
+void Global::release_slot(const size_t id)
 {
+  claimed_[id / 64].fetch_and(~(1ull << (id % 64)));
 }
 
-Thread::~Thread() {}
+Thread& Global::register_thread(const CommitMode commit_mode)
+{
+  const size_t id = claim_slot();
+  unique_ptr<Thread> ctx{new Thread(id, *this, commit_mode)};
+  auto& thread_ctx = *ctx;
+
+  {
+    /* stats() may be walking `threads_` */
+    lock_guard<mutex> guard{stats_lock_};
+    threads_[id] = move(ctx);
+  }
+
+  if (commit_mode == CommitMode::Async) {
+    try {
+      thread_ctx.shadow_id_ = claim_slot();
+    }
+    catch (...) {
+      {
+        lock_guard<mutex> guard{stats_lock_};
+        threads_[id].reset();
+      }
+
+      release_slot(id);
+      throw;
+    }
+
+    state(thread_ctx.shadow_id_).write_clock = numeric_limits<uint64_t>::max();
+
+    lock_guard<mutex> guard{commit_lock_};
+    if (!committer_.joinable()) {
+      committer_ = thread{[this] { run_committer(); }};
+    }
+  }
+
+  active_[id / 64].fetch_or(1ull << (id % 64));
+  return thread_ctx;
+}
+
+void Global::unregister_thread(Thread& thread_ctx)
+{
+  const size_t id = thread_ctx.thread_id();
+  const size_t shadow_id = thread_ctx.shadow_id_;
+
+  if (threads_[id].get() != &thread_ctx) {
+    throw runtime_error("unknown thread context");
+  }
+
+  /* nobody can be waiting on our locks after this */
+  thread_ctx.flush();
+
+  /* synchronize() doesn't wait for the readers past our write clock, and
+     those may have stolen a copy from our logs: before the logs are gone,
+     every reader in a section has to leave it */
+  thread_ctx.synchronize(numeric_limits<uint64_t>::max());
+
+  active_[id / 64].fetch_and(~(1ull << (id % 64)));
+
+  {
+    lock_guard<mutex> guard{stats_lock_};
+    retired_stats_.merge(thread_ctx.stats());
+    threads_[id].reset();
+  }
+
+  release_slot(id);
+  if (shadow_id < MAX_THREADS) release_slot(shadow_id);
+}
+
+void Global::enqueue_commit(Thread& writer)
+{
+  {
+    lock_guard<mutex> guard{commit_lock_};
+    commit_queue_.push_back(&writer);
+  }
+
+  commit_ready_.notify_one();
+}
+
+void Global::run_committer()
+{
+  auto& committer = register_thread();
+  unique_lock<mutex> lock{commit_lock_};
+
+  while (true) {
+    commit_ready_.wait(lock,
+                       [this] { return stopping_ || !commit_queue_.empty(); });
+
+    if (commit_queue_.empty()) break;  // we're stopping
+
+    auto writer = commit_queue_.front();
+    commit_queue_.pop_front();
+
+    lock.unlock();
+    writer->commit_in_flight(committer);
+    lock.lock();
+  }
+
+  lock.unlock();
+  unregister_thread(committer);
+}
+
+void ThreadStats::merge(const ThreadStats& other)
+{
+  read_sections += other.read_sections;
+  write_sections += other.write_sections;
+  aborts += other.aborts;
+  lock_failures += other.lock_failures;
+  steals += other.steals;
+  log_bytes += other.log_bytes;
+  syncs += other.syncs;
+  sync_cycles += other.sync_cycles;
+  sync_sleeps += other.sync_sleeps;
+}
+
+ThreadStats Global::stats()
+{
+  lock_guard<mutex> guard{stats_lock_};
+  ThreadStats total = retired_stats_;
+
+  for (const auto& thread : threads_) {
+    if (thread) total.merge(thread->stats());
+  }
+
+  return total;
+}
+
+size_t Global::thread_count() const
+{
+  size_t count = 0;
+  for (const auto& word : active_) count += __builtin_popcountll(word);
+  return count;
+}
+
+Thread::Thread(const size_t thread_id, Global& global_context,
+               const CommitMode commit_mode)
+    : thread_id_(thread_id),
+      global_ctx_(global_context),
+      state_(global_context.state(thread_id)),
+      commit_mode_(commit_mode),
+      clock_source_(global_context.clock_source()),
+      lock_id_(thread_id),
+      run_count_(state_.run_count.load())
+{
+  state_.write_clock = numeric_limits<uint64_t>::max();
+  state_.sync_requested = false;
+
+  retired_.reserve(64);
+  sync_waits_.reserve(64);
+  commit_group_.reserve(64);
+}
+
+Thread::~Thread() { free_retired(); }
+
+Thread::WriteLog::~WriteLog()
+{
+  for (auto& segment : segments_) {
+    munmap(segment.data, WRITE_LOG_SEGMENT_SIZE);
+  }
+}
+
+void Thread::WriteLog::add_segment()
+{
+  constexpr int prot = PROT_READ | PROT_WRITE;
+  constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  void* data = MAP_FAILED;
+
+#ifdef RLU_HUGE_PAGES
+  data = mmap(nullptr, WRITE_LOG_SEGMENT_SIZE, prot, flags | MAP_HUGETLB, -1,
+              0);
+
+  if (data == MAP_FAILED) {
+    /* no reserved huge pages; transparent ones will have to do */
+    data = mmap(nullptr, WRITE_LOG_SEGMENT_SIZE, prot, flags, -1, 0);
+    if (data != MAP_FAILED) {
+      madvise(data, WRITE_LOG_SEGMENT_SIZE, MADV_HUGEPAGE);
+    }
+  }
+#else
+  data = mmap(nullptr, WRITE_LOG_SEGMENT_SIZE, prot, flags, -1, 0);
+#endif
+
+  if (data == MAP_FAILED) {
+    throw runtime_error("could not grow the write log");
+  }
+
+  segments_.push_back({reinterpret_cast<uint8_t*>(data), 0});
+}
+
+void Thread::WriteLog::truncate(const size_t pos)
+{
+  const size_t last = pos / WRITE_LOG_SEGMENT_SIZE;
+
+  for (size_t i = last; i < segments_.size(); i++) {
+    segments_[i].used =
+        (i == last) ? min(segments_[i].used, pos % WRITE_LOG_SEGMENT_SIZE) : 0;
+  }
+
+  pos_ = pos;
+}
+
+void Thread::WriteLog::reserve(const size_t count, const size_t object_size)
+{
+  /* entries don't straddle segments, so a segment holds a whole number of
+     them */
+  const size_t per_segment = WRITE_LOG_SEGMENT_SIZE / entry_size(object_size);
+  const size_t last =
+      pos_ / WRITE_LOG_SEGMENT_SIZE + (count + per_segment - 1) / per_segment;
+
+  while (segments_.size() <= last) add_segment();
+}
+
+void Thread::WriteLog::recycle()
+{
+  const size_t needed =
+      max(WRITE_LOG_KEEP_SEGMENTS,
+          (pos_ + WRITE_LOG_SEGMENT_SIZE - 1) / WRITE_LOG_SEGMENT_SIZE);
+
+  truncate(0);
+
+  while (segments_.size() > needed) {
+    munmap(segments_.back().data, WRITE_LOG_SEGMENT_SIZE);
+    segments_.pop_back();
+  }
+}
+
+bool Thread::WriteLog::appended_since(const size_t from,
+                                      const Pointer copy) const
+{
+  const auto ptr = reinterpret_cast<const uint8_t*>(copy);
+  const size_t first = from / WRITE_LOG_SEGMENT_SIZE;
+
+  for (size_t i = first; i < segments_.size(); i++) {
+    const auto data = segments_[i].data;
+
+    if (ptr >= data && ptr < data + WRITE_LOG_SEGMENT_SIZE) {
+      return i > first || ptr >= data + from % WRITE_LOG_SEGMENT_SIZE;
+    }
+  }
+
+  return false;
+}
 
 void Thread::reader_lock()
 {
   is_writer_ = false;
-  run_count_++;
+  section_start_ = write_log_.pos();
+  section_retired_ = retired_.size();
+
+  /* the run count has to be visible before we read the clock (and anything
+     else), or a writer could miss us in synchronize() */
+  state_.run_count.store(++run_count_);
+  local_clock_ = (clock_source_ == ClockSource::Ordo)
+                     ? ordo::now()
+                     : global_ctx_.clock.load();
+  state_.local_clock.store(local_clock_, memory_order_relaxed);
 
-  local_clock_ = global_ctx_.clock.load();
+  /* a retried operation keeps the priority of its first try */
+  if (retries_ == 0) state_.priority.store(local_clock_, memory_order_relaxed);
 }
 
 void Thread::reader_unlock()
 {
-  run_count_++;
+  state_.run_count.store(++run_count_, memory_order_release);
+  wake_sleepers();
+  retries_ = 0;
+  ThreadStats::count(is_writer_ ? stats_.write_sections : stats_.read_sections);
 
-  if (is_writer_) {
+  if (commit_mode_ == CommitMode::Immediate) {
+    if (is_writer_) commit_write_log();
+  }
+  else if (commit_mode_ == CommitMode::Async) {
+    if (is_writer_) seal_write_log();
+  }
+  else if (write_log_.pos() >= DEFER_LOG_THRESHOLD ||
+           state_.sync_requested.load(memory_order_relaxed)) {
+    flush();
+  }
+}
+
+void Thread::flush()
+{
+  if (commit_mode_ == CommitMode::Async) {
+    wait_for_in_flight();
+  }
+  else if (write_log_.pos() > 0) {
     commit_write_log();
   }
+  else {
+    state_.sync_requested = false;
+  }
 }
 
-bool Thread::compare_objects(Pointer obj1, Pointer obj2)
+void Thread::retire(Pointer ptr, void (*deleter)(Pointer))
 {
-  return util::get_actual(obj1) == util::get_actual(obj2);
+  retired_.emplace_back(ptr, deleter);
+}
+
+void Thread::free_retired()
+{
+  for (auto& [ptr, deleter] : retired_) deleter(ptr);
+  retired_.clear();
+  section_retired_ = 0;
 }
 
-void Thread::writeback_write_log()
+bool Thread::compare_objects(Pointer obj1, Pointer obj2)
 {
-  uint8_t* dataPtr = write_log_.log;
-  const uint8_t* end = dataPtr + write_log_.pos;
+  return util::get_actual(obj1) == util::get_actual(obj2);
+}
 
-  while (dataPtr < end) {
-    auto header = reinterpret_cast<WriteLogEntryHeader*>(dataPtr);
-    dataPtr += sizeof(WriteLogEntryHeader);
+void Thread::writeback_write_log() { writeback(write_log_); }
 
-    memcpy(header->actual, dataPtr, header->object_size);
-    util::object_header(header->actual)
+void Thread::writeback(WriteLog& log)
+{
+  log.for_each_entry(0, [](WriteLogEntryHeader* header) {
+    memcpy(header->actual(), reinterpret_cast<uint8_t*>(header + 1),
+           header->object_size());
+    util::object_header(header->actual())
         ->copy.store(nullptr);  // Unlock the object
     header->~WriteLogEntryHeader();
+  });
+}
 
-    dataPtr += header->object_size;
+void Thread::unlock_write_log(const size_t from)
+{
+  write_log_.for_each_entry(from, [](WriteLogEntryHeader* header) {
+    util::object_header(header->actual())
+        ->copy.store(nullptr);  // Unlock the object
+  });
+}
+
+void Thread::commit_write_log()
+{
+  state_.sync_requested = false;
+  commit_stats_.commits++;
+
+  if (group_commit_) {
+    request_grace_period();
   }
+  else {
+    const uint64_t write_clock = next_write_clock();
+    state_.write_clock = write_clock;
+    advance_clock(write_clock);
+
+    synchronize(write_clock);
+    commit_stats_.grace_periods++;
+  }
+
+  writeback_write_log();
+  free_retired();
+
+  state_.write_clock = numeric_limits<uint64_t>::max();
+  state_.releases.fetch_add(1, memory_order_release);
+  swap_write_logs();
 }
 
-void Thread::unlock_write_log()
+uint64_t Thread::next_write_clock()
 {
-  uint8_t* dataPtr = write_log_.log;
-  uint8_t* end = dataPtr + write_log_.pos;
+  /* with ORDO: ahead of every core's clock, so no reader that's already
+     running takes our copies */
+  return (clock_source_ == ClockSource::Ordo)
+             ? ordo::now() + ordo::boundary() + 1
+             : global_ctx_.clock.load() + 1;
+}
 
-  while (dataPtr < end) {
-    auto header = reinterpret_cast<WriteLogEntryHeader*>(dataPtr);
-    dataPtr += sizeof(WriteLogEntryHeader) + header->object_size;
+void Thread::advance_clock(const uint64_t write_clock)
+{
+  /* every reader that starts from now on takes the copies */
+  if (clock_source_ == ClockSource::Ordo) {
+    ordo::wait_until_past(write_clock);
+  }
+  else {
+    global_ctx_.clock.fetch_add(1);
+  }
+}
 
-    util::object_header(header->actual)
-        ->copy.store(nullptr);  // Unlock the object
+void Thread::request_grace_period()
+{
+  const uint64_t ticket = state_.grace_periods.load(memory_order_acquire);
+  auto& combining = global_ctx_.combining_;
+
+  global_ctx_.commit_requests_[thread_id_ / 64].fetch_or(
+      1ull << (thread_id_ % 64));
+
+  for (size_t round = 0;
+       state_.grace_periods.load(memory_order_acquire) == ticket; round++) {
+    if (!combining.load(memory_order_relaxed) &&
+        !combining.exchange(true, memory_order_acquire)) {
+      run_group_grace_period();
+      combining.store(false, memory_order_release);
+    }
+    else if (wait_policy_ == WaitPolicy::Spin || round < SYNC_SPINS) {
+      util::cpu_relax();
+    }
+    else {
+      this_thread::yield();
+    }
   }
 }
 
-void Thread::commit_write_log()
+void Thread::run_group_grace_period()
 {
-  write_clock_ = global_ctx_.clock.load() + 1;
-  global_ctx_.clock.fetch_add(1);
+  /* everyone who has asked so far; that's us, too, unless the last group
+     took us in but hasn't told us yet */
+  commit_group_.clear();
 
-  synchronize();
-  writeback_write_log();
+  for (size_t w = 0; w < Global::BITMAP_WORDS; w++) {
+    for (uint64_t word = global_ctx_.commit_requests_[w].exchange(0);
+         word != 0; word &= word - 1) {
+      commit_group_.push_back(w * 64 + __builtin_ctzll(word));
+    }
+  }
 
-  write_clock_ = numeric_limits<uint64_t>::max();
-  swap_write_logs();
+  if (commit_group_.empty()) return;
+
+  const uint64_t write_clock = next_write_clock();
+
+  for (const auto id : commit_group_) {
+    global_ctx_.state(id).write_clock = write_clock;
+  }
+
+  advance_clock(write_clock);
+  synchronize(write_clock);
+  commit_stats_.grace_periods++;
+
+  /* the members write their logs back themselves, all at once */
+  for (const auto id : commit_group_) {
+    global_ctx_.state(id).grace_periods.fetch_add(1, memory_order_release);
+  }
+}
+
+void Thread::seal_write_log()
+{
+  state_.sync_requested = false;
+  commit_stats_.commits++;
+
+  /* one log in flight at a time */
+  wait_for_in_flight();
+
+  /* the last in-flight log is the quiescent one now, and the one before it
+     went out of reach with the last commit's grace period */
+  write_log_in_flight_.swap(write_log_);
+  write_log_.swap(write_log_quiesce_);
+  write_log_.recycle();
+
+  in_flight_retired_.swap(retired_);
+  section_retired_ = 0;
+
+  in_flight_id_ = lock_id_;
+  lock_id_ = (lock_id_ == thread_id_) ? shadow_id_ : thread_id_;
+
+  in_flight_.store(true, memory_order_relaxed);
+  global_ctx_.enqueue_commit(*this);
+}
+
+void Thread::wait_for_in_flight()
+{
+  for (size_t round = 0; in_flight_.load(memory_order_acquire); round++) {
+    if (wait_policy_ == WaitPolicy::Spin || round < SYNC_SPINS) {
+      util::cpu_relax();
+    }
+    else {
+      this_thread::yield();
+    }
+  }
+}
+
+void Thread::commit_in_flight(Thread& committer)
+{
+  auto& state = global_ctx_.state(in_flight_id_);
+
+  const uint64_t write_clock = committer.next_write_clock();
+  state.write_clock = write_clock;
+  committer.advance_clock(write_clock);
+  committer.synchronize(write_clock);
+  committer.commit_stats_.grace_periods++;
+
+  writeback(write_log_in_flight_);
+
+  for (auto& [ptr, deleter] : in_flight_retired_) deleter(ptr);
+  in_flight_retired_.clear();
+
+  state.write_clock = numeric_limits<uint64_t>::max();
+  state.releases.fetch_add(1, memory_order_release);
+
+  in_flight_.store(false, memory_order_release);
 }
 
 void Thread::swap_write_logs()
 {
-  auto ptr_copy = write_log_.log;
-  write_log_.log = write_log_quiesce_.log;
-  write_log_quiesce_.log = ptr_copy;
-  write_log_quiesce_.pos = write_log_.pos;
-  write_log_.pos = 0;
+  /* the quiescent log's copies went out of reach with this commit's grace
+     period, so it can be reused */
+  write_log_.swap(write_log_quiesce_);
+  write_log_.recycle();
 }
 
 void Thread::synchronize()
 {
-  uint64_t sync_counts[MAX_THREADS];
+  synchronize(state_.write_clock.load(memory_order_relaxed));
+}
 
-  for (const auto& thread : global_ctx_.threads) {
-    sync_counts[thread->thread_id_] = thread->run_count_;
+void Thread::synchronize(const uint64_t write_clock)
+{
+  sync_waits_.clear();
+  ThreadStats::count(stats_.syncs);
+
+  /* only the threads that were inside a section when we looked matter */
+  for (size_t w = 0; w < Global::BITMAP_WORDS; w++) {
+    for (uint64_t word = global_ctx_.active_[w]; word != 0;
+         word &= word - 1) {
+      const size_t id = w * 64 + __builtin_ctzll(word);
+      if (id == thread_id_) continue;
+
+      const uint64_t run_count = global_ctx_.state(id).run_count;
+      if (run_count % 2 != 0) sync_waits_.emplace_back(id, run_count);
+    }
   }
 
-  for (const auto& thread : global_ctx_.threads) {
-    if (thread->thread_id_ == thread_id_) continue;
+  const uint64_t wait_start = STATS_ENABLED ? util::cycles() : 0;
+
+  for (const auto& [id, run_count] : sync_waits_) {
+    auto& other = global_ctx_.state(id);
 
-    while (sync_counts[thread->thread_id_] % 2 != 0) {
-      if (sync_counts[thread->thread_id_] != thread->run_count_) break;
-      if (write_clock_ <= thread->local_clock_) break;
+    for (size_t round = 0;; round++) {
+      if (run_count != other.run_count) break;
+      if (write_clock <= other.local_clock) break;
+
+      wait_for_reader(other, run_count, round);
     }
   }
+
+  if (STATS_ENABLED && !sync_waits_.empty()) {
+    ThreadStats::count(stats_.sync_cycles, util::cycles() - wait_start);
+  }
+}
+
+void Thread::wait_for_reader(ThreadState& other, const uint64_t run_count,
+                             const size_t round)
+{
+  if (wait_policy_ == WaitPolicy::Spin || round < SYNC_SPINS) {
+    util::cpu_relax();
+    return;
+  }
+
+  if (wait_policy_ == WaitPolicy::Yield || round < SYNC_SPINS + SYNC_YIELDS) {
+    this_thread::yield();
+    return;
+  }
+
+  /* the kernel checks the run count again, so a reader that left the
+     section in the meantime doesn't put us to sleep */
+  ThreadStats::count(stats_.sync_sleeps);
+  other.sleepers.fetch_add(1);
+  futex_wait(futex_word(other.run_count), static_cast<uint32_t>(run_count));
+  other.sleepers.fetch_sub(1, memory_order_relaxed);
+}
+
+void Thread::wake_sleepers()
+{
+  if (state_.sleepers.load(memory_order_relaxed) != 0) {
+    futex_wake(futex_word(state_.run_count));
+  }
 }
 
 void Thread::abort()
 {
-  run_count_++;
+  ThreadStats::count(stats_.aborts);
+
+  state_.run_count.store(++run_count_, memory_order_release);
+  wake_sleepers();
 
   if (is_writer_) {
-    unlock_write_log();
-    write_log_.pos = 0;
+    /* only this section is rolled back; the deferred ones are kept */
+    unlock_write_log(section_start_);
+    write_log_.truncate(section_start_);
+    global_ctx_.state(lock_id_).releases.fetch_add(1, memory_order_release);
+  }
+
+  retired_.resize(section_retired_);  // nothing was unlinked after all
+
+  if (commit_mode_ == CommitMode::Deferred && state_.sync_requested) {
+    flush();
   }
+
+  if (in_flight_conflict_) {
+    in_flight_conflict_ = false;
+    wait_for_in_flight();
+  }
+
+  resolve_contention();
+}
+
+void Thread::resolve_contention()
+{
+  contention_stats_.aborts++;
+  retries_++;
+  contention_stats_.max_retries =
+      max(contention_stats_.max_retries, retries_);
+
+  /* our own deferred lock; abort() has committed it already */
+  if (conflict_holder_ == thread_id_) return;
+
+  switch (contention_policy_) {
+  case ContentionPolicy::None: break;
+  case ContentionPolicy::Backoff: backoff(); break;
+  case ContentionPolicy::WaitForHolder: wait_for_holder(); break;
+
+  case ContentionPolicy::Priority:
+    if (conflict_holder_ < MAX_THREADS) {
+      const auto& holder = global_ctx_.state(conflict_holder_);
+      const auto ours = make_pair(state_.priority.load(), thread_id_);
+      const auto theirs = make_pair(holder.priority.load(), conflict_holder_);
+
+      if (ours < theirs) {
+        wait_for_holder();  // we're older, so we're next in line
+        break;
+      }
+    }
+
+    /* the younger ones don't queue up behind the holder, but step aside, so
+       that an older operation waiting for the same lock gets it first */
+    backoff();
+    this_thread::yield();
+    break;
+  }
+}
+
+void Thread::backoff()
+{
+  if (backoff_seed_ == 0) backoff_seed_ = 0x9e3779b97f4a7c15ull ^ thread_id_;
+
+  backoff_seed_ ^= backoff_seed_ << 13;
+  backoff_seed_ ^= backoff_seed_ >> 7;
+  backoff_seed_ ^= backoff_seed_ << 17;
+
+  const uint64_t limit = 1ull << min<uint64_t>(retries_, MAX_BACKOFF_SHIFT);
+
+  for (uint64_t i = backoff_seed_ % limit; i > 0; i--) {
+    util::cpu_relax();
+  }
+}
+
+void Thread::wait_for_holder()
+{
+  if (conflict_holder_ >= MAX_THREADS) {
+    backoff();
+    return;
+  }
+
+  const auto& holder = global_ctx_.state(conflict_holder_);
+  contention_stats_.waits++;
+
+  for (size_t i = 0; i < MAX_CONTENTION_WAIT; i++) {
+    if (holder.releases != conflict_releases_) break;
+
+    /* the holder may be waiting on one of our deferred locks, too */
+    if (commit_mode_ == CommitMode::Deferred && state_.sync_requested) {
+      flush();
+    }
+
+    if (i < 64) {
+      util::cpu_relax();
+    }
+    else {
+      this_thread::yield();
+    }
+  }
+}
+
+bool Thread::migrate_to_local_node()
+{
+  unsigned node = 0;
+  if (!numa::current_node(node)) return false;
+
+  bool ok = true;
+
+  /* segments allocated from now on are first touched by us anyway */
+  for (auto log : {&write_log_, &write_log_quiesce_}) {
+    for (size_t i = 0; i < log->segment_count(); i++) {
+      const auto segment = log->segment(i);
+      ok = numa::bind_to_node(segment, WRITE_LOG_SEGMENT_SIZE, node) && ok;
+    }
+  }
+
+  /* sharing the page with other threads' states, it has nowhere to go */
+  if (global_ctx_.numa_local()) {
+    ok = numa::bind_to_node(&state_, sizeof(ThreadState), node) && ok;
+  }
+
+  return ok;
 }
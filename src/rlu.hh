@@ -3,38 +3,116 @@
 #ifndef RLU_HH
 #define RLU_HH
 
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <thread>
 #include <utility>
 #include <vector>
 
+#include "ordo.hh"
+#include "slab.hh"
+
 namespace rlu {
 
 constexpr intptr_t SPECIAL_CONSTANT = 0x1020304050607080ull;
-constexpr size_t WRITE_LOG_SIZE = 1024 * 1024;  // 1 MB
 constexpr size_t MAX_THREADS = 256;
 
+/* write logs grow (and shrink) a segment at a time; with RLU_HUGE_PAGES, the
+   segments are backed by 2 MB pages when the system has them */
+#ifdef RLU_HUGE_PAGES
+constexpr size_t WRITE_LOG_SEGMENT_SIZE = 2 * 1024 * 1024;
+#else
+constexpr size_t WRITE_LOG_SEGMENT_SIZE = 256 * 1024;
+#endif
+
+// a write log keeps this many segments between rounds, whatever it used
+constexpr size_t WRITE_LOG_KEEP_SEGMENTS = 1;
+
+// a deferring thread commits once its write log grows past this
+constexpr size_t DEFER_LOG_THRESHOLD = 64 * 1024;
+
 using Pointer = void*;
 
 struct ObjectHeader {
   std::atomic<Pointer> copy{nullptr};
 };
 
+/* with RLU_COMPACT_HEADERS, the thread id and the object size are packed into
+   the spare bits of the `actual` pointer, which halves the header: user-space
+   addresses fit in 48 bits, and objects are 8-byte aligned (they follow their
+   ObjectHeader). The top 8 bits hold the thread id, the next 8 the size in
+   words (rounded up), and the low 3 bits how much the rounding added. */
 struct WriteLogEntryHeader {
-  uint64_t thread_id{0};
-  uint64_t object_size{0};
-  Pointer actual{nullptr};
+#ifdef RLU_COMPACT_HEADERS
+  static constexpr size_t MAX_OBJECT_SIZE = 255 * 8;
+
+  uint64_t packed{0};
+#else
+  static constexpr size_t MAX_OBJECT_SIZE = std::numeric_limits<size_t>::max();
+
+  uint64_t thread_id_{0};
+  uint64_t object_size_{0};
+  Pointer actual_{nullptr};
+#endif
 
   // must be the last one
   ObjectHeader copy{reinterpret_cast<void*>(SPECIAL_CONSTANT)};
+
+  WriteLogEntryHeader(const size_t thread_id, const Pointer actual,
+                      const size_t object_size);
+
+  size_t thread_id() const;
+  size_t object_size() const;
+  Pointer actual() const;
 };
 
+#ifdef RLU_COMPACT_HEADERS
+static_assert(MAX_THREADS <= 256, "thread ids don't fit in 8 bits");
+
+inline WriteLogEntryHeader::WriteLogEntryHeader(const size_t thread_id,
+                                                const Pointer actual,
+                                                const size_t object_size)
+    : packed((uint64_t{thread_id} << 56) |
+             (uint64_t{(object_size + 7) / 8} << 48) |
+             reinterpret_cast<uintptr_t>(actual) | ((8 - object_size % 8) % 8))
+{
+}
+
+inline size_t WriteLogEntryHeader::thread_id() const { return packed >> 56; }
+
+inline size_t WriteLogEntryHeader::object_size() const
+{
+  return ((packed >> 48) & 0xff) * 8 - (packed & 7);
+}
+
+inline Pointer WriteLogEntryHeader::actual() const
+{
+  return reinterpret_cast<Pointer>(packed & 0x0000fffffffffff8ull);
+}
+#else
+inline WriteLogEntryHeader::WriteLogEntryHeader(const size_t thread_id,
+                                                const Pointer actual,
+                                                const size_t object_size)
+    : thread_id_(thread_id), object_size_(object_size), actual_(actual)
+{
+}
+
+inline size_t WriteLogEntryHeader::thread_id() const { return thread_id_; }
+inline size_t WriteLogEntryHeader::object_size() const { return object_size_; }
+inline Pointer WriteLogEntryHeader::actual() const { return actual_; }
+#endif
+
 namespace util {
 
 template <class T>
@@ -67,7 +145,7 @@ template <class T>
 inline T* get_actual(T* obj)
 {
   return reinterpret_cast<T*>(
-      is_copy(get_copy(obj)) ? (writelog_header(obj)->actual) : obj);
+      is_copy(get_copy(obj)) ? (writelog_header(obj)->actual()) : obj);
 }
 
 template <class T>
@@ -76,62 +154,470 @@ inline bool is_unlocked(T* obj)
   return obj == nullptr;
 }
 
+// a cheap timestamp, for the statistics
+inline uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// tells the CPU that we're spinning
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
 }  // namespace util
 
 namespace context {
 
 class Thread;
 
+/* In `Immediate` mode every write section is committed (and synchronized) in
+   its `reader_unlock()`. In `Deferred` mode (RLU-deferred), the locked objects
+   stay in the write log across write sections, and they are only committed
+   when the log passes `DEFER_LOG_THRESHOLD`, when another thread asks for it
+   by hitting one of our locks, or when `flush()` is called. In `Async` mode,
+   `reader_unlock()` hands the write log over to the committer thread of
+   `Global`, which waits for the grace period and writes it back, while the
+   writer goes on with a fresh log; it only waits for the commit when it's
+   ready to hand over the next log, or when it tries to lock an object that's
+   still in the one being committed. */
+enum class CommitMode { Immediate, Deferred, Async };
+
+/* What a thread does in `abort()`, after it failed to lock an object and
+   before it restarts the operation:
+   - `None`: nothing, it restarts right away.
+   - `Backoff`: spins for a random time, doubling its range on every retry.
+   - `WaitForHolder`: waits (for a bounded time) until the holder of the
+     object it failed to lock gives up its locks, by a write-back or an
+     abort; if it doesn't know the holder, it backs off instead.
+   - `Priority`: the operation that started first (by its clock) wins: if
+     it's older than the holder, it waits for it like `WaitForHolder`, and
+     if it's younger, it backs off and yields instead, without waiting, so
+     that the older ones get the lock before it retries. */
+enum class ContentionPolicy { None, Backoff, WaitForHolder, Priority };
+
+/* Where the section timestamps come from:
+   - `Logical`: the shared counter `Global::clock`, which every commit bumps.
+   - `Ordo`: the cores' invariant TSCs (see ordo.hh). A commit then doesn't
+     touch any shared line, but it has to wait out twice the clocks'
+     uncertainty window. */
+enum class ClockSource { Logical, Ordo };
+
+/* How synchronize() waits for a reader to leave its section:
+   - `Spin`: spins (with a pause) until it does.
+   - `Yield`: spins for `SYNC_SPINS` rounds, then yields the CPU on every
+     round after that.
+   - `Block`: spins and yields like `Yield`, then sleeps on a futex that the
+     reader wakes in `reader_unlock()`. It's what keeps the writers from
+     burning their timeslices on descheduled readers when there are more
+     threads than cores. */
+enum class WaitPolicy { Spin, Yield, Block };
+
+struct ContentionStats {
+  uint64_t aborts{0};       // failed try_lock()s, each followed by a retry
+  uint64_t waits{0};        // aborts that waited for the holder
+  uint64_t max_retries{0};  // the longest retry streak of an operation
+
+  void merge(const ContentionStats& other)
+  {
+    aborts += other.aborts;
+    waits += other.waits;
+    max_retries = std::max(max_retries, other.max_retries);
+  }
+};
+
+/* With group commit, a committing thread that finds another one already
+   running a grace period leaves its commit to the next one, which covers
+   every thread that asked by then with a single clock update and a single
+   scan of the readers. */
+struct CommitStats {
+  uint64_t commits{0};
+  uint64_t grace_periods{0};  // the ones this thread ran, for itself or all
+
+  void merge(const CommitStats& other)
+  {
+    commits += other.commits;
+    grace_periods += other.grace_periods;
+  }
+};
+
+/* Runtime counters, kept by every thread for itself in a cache line of its
+   own and summed up by `Global::stats()`. They cost nothing unless the
+   library is built with RLU_STATS. */
+#ifdef RLU_STATS
+constexpr bool STATS_ENABLED = true;
+#else
+constexpr bool STATS_ENABLED = false;
+#endif
+
+struct alignas(CACHELINE_SIZE) ThreadStats {
+  uint64_t read_sections{0};
+  uint64_t write_sections{0};
+  uint64_t aborts{0};
+  uint64_t lock_failures{0};  // try_lock() calls that returned false
+  uint64_t steals{0};         // copies taken from other threads' logs
+  uint64_t log_bytes{0};      // appended to the write logs
+  uint64_t syncs{0};          // synchronize() calls
+  uint64_t sync_cycles{0};    // spent waiting in synchronize()
+  uint64_t sync_sleeps{0};    // futex waits in synchronize()
+
+  void merge(const ThreadStats& other);
+
+  static void count(uint64_t& counter, const uint64_t n = 1)
+  {
+    if (STATS_ENABLED) counter += n;
+  }
+};
+
+/*
+ * The part of a thread's state that other threads read (or write). It lives in
+ * a slab owned by `Global`, and every group of fields with a different writer
+ * gets a cache line of its own, so that e.g. a reader bumping its run count
+ * doesn't invalidate the line a writer's `dereference()` is looking at.
+ */
+struct alignas(CACHELINE_SIZE) ThreadState {
+  /* written by the owner on every section boundary, read by synchronize() */
+  std::atomic<uint64_t> run_count{0};
+  std::atomic<uint64_t> local_clock{0};
+  std::atomic<uint64_t> priority{0};  // clock of the operation's first try
+
+  /* written on commits (by the owner, or its committer), read by the others'
+     dereference(); `releases` goes up every time the locks taken under this
+     id are given up, by a write-back or an abort */
+  alignas(CACHELINE_SIZE) std::atomic<uint64_t> write_clock{
+      std::numeric_limits<uint64_t>::max()};
+  std::atomic<uint64_t> releases{0};
+
+  /* written by the other threads, when they hit one of our deferred locks or
+     go to sleep until we leave our section */
+  alignas(CACHELINE_SIZE) std::atomic<bool> sync_requested{false};
+  std::atomic<uint32_t> sleepers{0};
+  std::atomic<uint64_t> grace_periods{0};  // run for us by a group commit
+
+  void request_sync()
+  {
+    if (!sync_requested.load(std::memory_order_relaxed)) sync_requested = true;
+  }
+};
+
+/*
+ * Threads come and go through `register_thread()` and `unregister_thread()`,
+ * which are safe to call while the others are running. Every registered
+ * thread has a bit in `active_`, and synchronize() only looks at those.
+ */
 class Global {
 public:
-  std::atomic<uint64_t> clock{0};
-  std::vector<std::unique_ptr<Thread>> threads{};
+  static constexpr size_t BITMAP_WORDS = (MAX_THREADS + 63) / 64;
+
+private:
+  /* with `numa_local`, every thread state gets a page of its own, so that it
+     can be placed on its owner's NUMA node */
+  const bool numa_local_;
+  const ClockSource clock_source_;
+  const size_t state_stride_;
+  uint8_t* states_{nullptr};
+
+  /* a slot is claimed first, and becomes active once its thread is ready */
+  std::array<std::atomic<uint64_t>, BITMAP_WORDS> claimed_{};
+  std::array<std::unique_ptr<Thread>, MAX_THREADS> threads_{};
+
+  /* read by every synchronize(), written only on (un)registration */
+  alignas(CACHELINE_SIZE) std::array<std::atomic<uint64_t>, BITMAP_WORDS>
+      active_{};
+
+  /* group commit: the threads waiting for a grace period, and whether one is
+     being run */
+  alignas(CACHELINE_SIZE) std::array<std::atomic<uint64_t>, BITMAP_WORDS>
+      commit_requests_{};
+  alignas(CACHELINE_SIZE) std::atomic<bool> combining_{false};
+
+  /* async commit: the writers with a log to commit, and the thread that
+     commits them, one at a time */
+  std::mutex commit_lock_{};
+  std::condition_variable commit_ready_{};
+  std::deque<Thread*> commit_queue_{};
+  bool stopping_{false};
+  std::thread committer_{};
+
+  size_t claim_slot();
+  void release_slot(const size_t id);
+
+  void enqueue_commit(Thread& writer);
+  void run_committer();
+
+  /* the counters of the threads that have unregistered */
+  alignas(CACHELINE_SIZE) std::mutex stats_lock_{};
+  ThreadStats retired_stats_{};
+
+  friend class Thread;
+
+public:
+  alignas(CACHELINE_SIZE) std::atomic<uint64_t> clock{0};
 
-  Global() {}
+  /* throws if the clock isn't available on this machine */
+  Global(const bool numa_local = false,
+         const ClockSource clock_source = ClockSource::Logical);
+  ~Global();
+
+  Global(const Global&) = delete;
+  Global& operator=(const Global&) = delete;
+
+  /* the returned context belongs to the calling thread until it's handed back
+     to `unregister_thread()`, which it has to be outside any section;
+     unregistering waits for every other thread that is inside a section to
+     leave it */
+  Thread& register_thread(const CommitMode commit_mode = CommitMode::Immediate);
+  void unregister_thread(Thread& thread_ctx);
+
+  size_t thread_count() const;
+
+  /* the sum over all the threads, past and present; threads may come and go
+     meanwhile, but the registered ones mustn't be running any sections */
+  ThreadStats stats();
+
+  bool numa_local() const { return numa_local_; }
+  ClockSource clock_source() const { return clock_source_; }
+  size_t state_stride() const { return state_stride_; }
+
+  ThreadState& state(const size_t thread_id)
+  {
+    return *reinterpret_cast<ThreadState*>(states_ +
+                                           thread_id * state_stride_);
+  }
 };
 
-class Thread {
-private:
-  struct WriteLog {
-    size_t pos{0};
-    uint8_t* log{nullptr};
+class alignas(CACHELINE_SIZE) Thread {
+public:
+  using CommitMode = context::CommitMode;
 
-    WriteLog() { log = new uint8_t[WRITE_LOG_SIZE]; }
-    ~WriteLog() { delete[] log; }
+  static constexpr size_t MAX_BACKOFF_SHIFT = 16;
+  static constexpr size_t MAX_CONTENTION_WAIT = 1 << 16;
+
+  /* synchronize()'s rounds of spinning and yielding before it sleeps */
+  static constexpr size_t SYNC_SPINS = 1 << 10;
+  static constexpr size_t SYNC_YIELDS = 1 << 4;
+
+private:
+  /*
+   * A write log made of fixed-size segments that are mmap'd on demand. Entries
+   * never straddle two segments, and positions are logical (`segment *
+   * WRITE_LOG_SEGMENT_SIZE + offset`), so they still only ever grow within a
+   * write set and can be compared.
+   */
+  class WriteLog {
+  private:
+    struct Segment {
+      uint8_t* data{nullptr};
+      size_t used{0};
+    };
+
+    std::vector<Segment> segments_{};
+    size_t pos_{0};
+
+    void add_segment();
+
+  public:
+    WriteLog() {}
+    ~WriteLog();
 
     WriteLog(const WriteLog&) = delete;
     WriteLog& operator=(const WriteLog&) = delete;
 
+    static constexpr size_t entry_size(const size_t object_size)
+    {
+      return sizeof(WriteLogEntryHeader) + ((object_size + 7) & ~size_t{7});
+    }
+
+    size_t pos() const { return pos_; }
+    size_t segment_count() const { return segments_.size(); }
+    uint8_t* segment(const size_t i) { return segments_[i].data; }
+
+    /* drops everything after `pos` */
+    void truncate(const size_t pos);
+
+    /* maps the segments for `count` more entries of `object_size` bytes */
+    void reserve(const size_t count, const size_t object_size);
+
+    /* empties the log for its next round, handing back the segments that its
+       last round didn't need */
+    void recycle();
+
+    void swap(WriteLog& other)
+    {
+      segments_.swap(other.segments_);
+      std::swap(pos_, other.pos_);
+    }
+
     template <class T>
     T* append_header(const uint64_t thread_id, T* ptr);
 
     template <class T>
-    void append_log(T* obj);
+    void append_log(T* copy, T* obj);
+
+    // was `copy` appended at, or after, position `from`?
+    bool appended_since(const size_t from, const Pointer copy) const;
+
+    /* calls `fn(header)` on every entry from position `from` on */
+    template <class Fn>
+    void for_each_entry(const size_t from, Fn&& fn);
   };
 
   const uint64_t thread_id_;
   Global& global_ctx_;
-
+  ThreadState& state_;
+  const CommitMode commit_mode_;
+  const ClockSource clock_source_;
+
+  /* In `Async` mode, a thread has a second (inactive) slot, and the logs it
+     hands over to the committer alternate between the two ids, so that each
+     in-flight log has a write clock of its own. `lock_id_` is the id of the
+     current log, and `in_flight_id_` the one of the log being committed. */
+  size_t shadow_id_{MAX_THREADS};
+  size_t lock_id_;
+  size_t in_flight_id_{MAX_THREADS};
+  std::atomic<bool> in_flight_{false};  // cleared by the committer
+
+  /* everything below is private to the owner */
   bool is_writer_{false};
-  volatile uint64_t run_count_{0};
-  volatile uint64_t local_clock_{0};
-  volatile uint64_t write_clock_{std::numeric_limits<uint64_t>::max()};
+  uint64_t run_count_{0};    // mirrors `state_.run_count`
+  uint64_t local_clock_{0};  // mirrors `state_.local_clock`
+  size_t section_start_{0};  // write log position when the section started
+
+  /* contention management: what the last failed try_lock() ran into */
+  ContentionPolicy contention_policy_{ContentionPolicy::None};
+  WaitPolicy wait_policy_{WaitPolicy::Block};
+  bool group_commit_{false};
+  CommitStats commit_stats_{};
+  ContentionStats contention_stats_{};
+  ThreadStats stats_{};
+  uint64_t retries_{0};       // of the current operation
+  uint64_t backoff_seed_{0};  // xorshift state
+  size_t conflict_holder_{MAX_THREADS};  // MAX_THREADS if we don't know
+  uint64_t conflict_releases_{0};        // the holder's, when we ran into it
 
   WriteLog write_log_{};
   WriteLog write_log_quiesce_{};
+  WriteLog write_log_in_flight_{};
+  bool in_flight_conflict_{false};  // try_lock() ran into the in-flight log
+
+  /* objects unlinked by the uncommitted write sections; they're deleted right
+     after the commit's write-back, as its grace period covers them */
+  std::vector<std::pair<Pointer, void (*)(Pointer)>> retired_{};
+  size_t section_retired_{0};  // `retired_` size when the section started
+  std::vector<std::pair<Pointer, void (*)(Pointer)>> in_flight_retired_{};
+
+  /* synchronize()'s scratch space: the threads we're waiting on */
+  std::vector<std::pair<size_t, uint64_t>> sync_waits_{};
+  std::vector<size_t> commit_group_{};  // ...and the group we commit for
+
+  void free_retired();
+
+  /* remembers who try_lock() ran into, for the contention manager */
+  void set_conflict(const size_t holder)
+  {
+    conflict_holder_ = holder;
+
+    if (holder < MAX_THREADS) {
+      conflict_releases_ = global_ctx_.state(holder).releases;
+    }
+  }
+
+  void resolve_contention();
+  void backoff();
+  void wait_for_holder();
+
+  /* the write clock of a commit starting now, and what makes it visible */
+  uint64_t next_write_clock();
+  void advance_clock(const uint64_t write_clock);
+
+  /* waits for the readers that may not see `write_clock` */
+  void synchronize(const uint64_t write_clock);
+
+  /* group commit: gets a grace period from whoever runs the next one, which
+     may well be us */
+  void request_grace_period();
+  void run_group_grace_period();
+
+  /* async commit: hands the log over to the committer, and waits for it to be
+     done with the last one */
+  void seal_write_log();
+  void wait_for_in_flight();
+
+  /* run by the committer, whose context is `committer` */
+  void commit_in_flight(Thread& committer);
+
+  static void writeback(WriteLog& log);
+
+  /* one round of synchronize()'s wait on `other` */
+  void wait_for_reader(ThreadState& other, const uint64_t run_count,
+                       const size_t round);
+
+  /* called right after every section's end */
+  void wake_sleepers();
+
+  /* created by `Global::register_thread()` */
+  Thread(const size_t thread_id, Global& global_context,
+         const CommitMode commit_mode);
+
+  friend class Global;
 
 public:
-  Thread(const size_t thread_id, Global& global_context);
   ~Thread();
 
   size_t thread_id() const { return thread_id_; }
+  CommitMode commit_mode() const { return commit_mode_; }
+
+  ContentionPolicy contention_policy() const { return contention_policy_; }
+  void set_contention_policy(const ContentionPolicy policy)
+  {
+    contention_policy_ = policy;
+  }
+
+  WaitPolicy wait_policy() const { return wait_policy_; }
+  void set_wait_policy(const WaitPolicy policy) { wait_policy_ = policy; }
+
+  bool group_commit() const { return group_commit_; }
+  void set_group_commit(const bool group_commit)
+  {
+    group_commit_ = group_commit;
+  }
+
+  const CommitStats& commit_stats() const { return commit_stats_; }
+
+  const ContentionStats& contention_stats() const
+  {
+    return contention_stats_;
+  }
+
+  const ThreadStats& stats() const { return stats_; }
 
   void reader_lock();
   void reader_unlock();
 
+  /* commits the deferred write sections, if any (must be called outside of
+     a section, e.g. before the thread goes idle) */
+  void flush();
+
   template <class T>
   T* dereference(T* obj);
 
+  /* makes room in the write log for `count` more locked Ts, so that a batch
+     doesn't have to map segments in the middle of its section */
+  template <class T>
+  void reserve_write_log(const size_t count)
+  {
+    write_log_.reserve(count, sizeof(T));
+  }
+
   template <class T>
   bool try_lock(T*& obj);
 
@@ -140,32 +626,44 @@ public:
 
   bool compare_objects(Pointer obj1, Pointer obj2);
   void commit_write_log();
-  void unlock_write_log();
+  void unlock_write_log(const size_t from = 0);
   void writeback_write_log();
   void swap_write_logs();
   void synchronize();
   void abort();
+
+  /* moves this thread's shared state and write logs to the NUMA node it is
+     currently running on; returns false if the kernel refused */
+  bool migrate_to_local_node();
+
+  /* defers `deleter(ptr)` until the current write section is committed; must
+     be called from the write section that made `ptr` unreachable. */
+  void retire(Pointer ptr, void (*deleter)(Pointer));
 };
 
 template <class T>
 void Thread::assign(T*& handle, T* obj)
 {
-  handle = util::get_actual(obj);
+  handle = (obj != nullptr) ? util::get_actual(obj) : nullptr;
 }
 
 template <class T>
 T* Thread::dereference(T* ptr)
 {
+  if (ptr == nullptr) return nullptr;
+
   auto ptr_copy = util::get_copy(ptr);
 
   if (util::is_unlocked(ptr_copy)) return ptr;  // it's free
   if (util::is_copy(ptr_copy)) return ptr;      // it's already a copy
 
-  const auto other_id = util::writelog_header(ptr_copy)->thread_id;
+  const auto other_id = util::writelog_header(ptr_copy)->thread_id();
 
-  if (other_id == thread_id_) return ptr_copy;  // locked by us
+  /* locked by us, in this log or in the one being committed */
+  if (other_id == thread_id_ || other_id == shadow_id_) return ptr_copy;
 
-  if (global_ctx_.threads[other_id]->write_clock_ <= local_clock_) {
+  if (global_ctx_.state(other_id).write_clock <= local_clock_) {
+    ThreadStats::count(stats_.steals);
     return ptr_copy; /* let's steal this copy */
   }
   else {
@@ -184,22 +682,46 @@ bool Thread::try_lock(T*& original_ptr)
 
   if (!util::is_unlocked(ptr_copy)) {
     const auto wl_header = util::writelog_header(ptr_copy);
-    if (wl_header->thread_id == thread_id_) {
-      original_ptr = ptr_copy;  // it's locked by us, let's send our copy
-      return true;
+    if (wl_header->thread_id() == thread_id_ ||
+        wl_header->thread_id() == shadow_id_) {
+      if (write_log_.appended_since(section_start_, ptr_copy)) {
+        original_ptr = ptr_copy;  // it's locked by us, let's send our copy
+        return true;
+      }
+
+      /* it's locked by one of our earlier (deferred or in-flight) write
+         sections, which have to be committed before we can touch it again */
+      if (commit_mode_ == CommitMode::Async) {
+        in_flight_conflict_ = true;
+      }
+      else {
+        state_.sync_requested = true;
+      }
+
+      set_conflict(thread_id_);
+      ThreadStats::count(stats_.lock_failures);
+      return false;
     }
 
+    global_ctx_.state(wl_header->thread_id()).request_sync();
+    set_conflict(wl_header->thread_id());
+    ThreadStats::count(stats_.lock_failures);
     return false;
   }
 
-  ptr_copy = write_log_.append_header(thread_id_, ptr);
+  const size_t log_pos = write_log_.pos();
+  ptr_copy = write_log_.append_header(lock_id_, ptr);
   void* expt = nullptr;
 
   if (!util::object_header(ptr)->copy.compare_exchange_weak(expt, ptr_copy)) {
+    write_log_.truncate(log_pos);  // drop the header
+    set_conflict(MAX_THREADS);  // lost the race, to someone
+    ThreadStats::count(stats_.lock_failures);
     return false;
   }
 
-  write_log_.append_log(ptr);
+  write_log_.append_log(ptr_copy, ptr);
+  ThreadStats::count(stats_.log_bytes, WriteLog::entry_size(sizeof(T)));
   original_ptr = ptr_copy;
 
   return true;
@@ -208,29 +730,53 @@ bool Thread::try_lock(T*& original_ptr)
 template <class T>
 T* Thread::WriteLog::append_header(const uint64_t thread_id, T* ptr)
 {
-  if (pos + sizeof(WriteLogEntryHeader) >= WRITE_LOG_SIZE) {
-    throw std::runtime_error("write log full");
+  constexpr size_t size = entry_size(sizeof(T));
+  static_assert(size <= WRITE_LOG_SEGMENT_SIZE, "object too large");
+  static_assert(sizeof(T) <= WriteLogEntryHeader::MAX_OBJECT_SIZE,
+                "object too large for a compact header");
+
+  size_t segment = pos_ / WRITE_LOG_SEGMENT_SIZE;
+  size_t offset = pos_ % WRITE_LOG_SEGMENT_SIZE;
+
+  if (offset + size > WRITE_LOG_SEGMENT_SIZE) {
+    segment++;  // the rest of this segment is left unused
+    offset = 0;
   }
 
-  auto wl_header = new (log + pos) WriteLogEntryHeader;
-  wl_header->thread_id = thread_id;
-  wl_header->actual = ptr;
-  wl_header->object_size = sizeof(T);
+  if (segment == segments_.size()) add_segment();
 
-  pos += sizeof(WriteLogEntryHeader);
+  auto& seg = segments_[segment];
+  new (seg.data + offset) WriteLogEntryHeader{thread_id, ptr, sizeof(T)};
 
-  return reinterpret_cast<T*>(log + pos);
+  seg.used = offset + size;
+  pos_ = segment * WRITE_LOG_SEGMENT_SIZE + seg.used;
+
+  return reinterpret_cast<T*>(seg.data + offset + sizeof(WriteLogEntryHeader));
 }
 
 template <class T>
-void Thread::WriteLog::append_log(T* obj)
+void Thread::WriteLog::append_log(T* copy, T* obj)
 {
-  if (pos + sizeof(T) >= WRITE_LOG_SIZE) {
-    throw std::runtime_error("write log full");
-  }
+  *copy = *obj;
+}
 
-  *reinterpret_cast<T*>(log + pos) = *obj;
-  pos += sizeof(T);
+template <class Fn>
+void Thread::WriteLog::for_each_entry(const size_t from, Fn&& fn)
+{
+  const size_t first = from / WRITE_LOG_SEGMENT_SIZE;
+
+  for (size_t i = first;
+       i < segments_.size() && i * WRITE_LOG_SEGMENT_SIZE < pos_; i++) {
+    uint8_t* data_ptr =
+        segments_[i].data + (i == first ? from % WRITE_LOG_SEGMENT_SIZE : 0);
+    const uint8_t* end = segments_[i].data + segments_[i].used;
+
+    while (data_ptr < end) {
+      auto header = reinterpret_cast<WriteLogEntryHeader*>(data_ptr);
+      data_ptr += entry_size(header->object_size());
+      fn(header);
+    }
+  }
 }
 
 }  // namespace context
@@ -241,7 +787,7 @@ template <class T, typename... Args>
 T* alloc(Args&&... args)
 {
   auto ptr =
-      reinterpret_cast<uint8_t*>(malloc(sizeof(ObjectHeader) + sizeof(T)));
+      reinterpret_cast<uint8_t*>(allocate(sizeof(ObjectHeader) + sizeof(T)));
 
   if (ptr != nullptr) {
     new (ptr) ObjectHeader;
@@ -258,7 +804,21 @@ void free(T* ptr)
 
   ptr->~T();
   util::object_header(ptr)->~ObjectHeader();
-  free(util::object_header(ptr));
+  deallocate(util::object_header(ptr), sizeof(ObjectHeader) + sizeof(T));
+}
+
+/*
+ * frees `ptr` once no reader can hold a reference to it anymore, i.e. after
+ * the grace period of the commit that unlinks it.
+ */
+template <class T>
+void retire(context::Thread& thread_ctx, T* ptr)
+{
+  if (ptr == nullptr) return;
+
+  thread_ctx.retire(util::get_actual(ptr), [](Pointer obj) {
+    free(reinterpret_cast<T*>(obj));
+  });
 }
 
 }  // namespace mem
@@ -0,0 +1,232 @@
+#include "skip-list.hh"
+
+#include <random>
+
+using namespace std;
+using namespace rlu;
+
+template <class K, class V>
+size_t SkipList<K, V>::random_height()
+{
+  static thread_local random_device dev;
+  static thread_local mt19937_64 rng{dev()};
+
+  // every level is kept with p = 1/4: two random bits per level
+  const uint64_t bits = rng();
+  size_t height = 1;
+
+  while (height < SkipNode<K, V>::MAX_HEIGHT &&
+         ((bits >> (2 * height)) & 3) == 0) {
+    height++;
+  }
+
+  return height;
+}
+
+template <class K, class V>
+SkipList<K, V>::SkipList()
+{
+  // creating a min-node and a max-node, both as tall as they get
+  constexpr auto MAX_HEIGHT = SkipNode<K, V>::MAX_HEIGHT;
+
+  auto tail = mem::alloc<SkipNode<K, V>>(numeric_limits<K>::max(), V{},
+                                         MAX_HEIGHT);
+  head_ = mem::alloc<SkipNode<K, V>>(numeric_limits<K>::min(), V{},
+                                     MAX_HEIGHT);
+
+  head_->next.fill(tail);
+}
+
+/*
+ * creates a skip list with `n` random keys (not thread-safe)
+ */
+template <class K, class V>
+SkipList<K, V>::SkipList(const size_t n, const K min, const K max) : SkipList()
+{
+  random_device dev;
+  mt19937 rng{dev()};
+  uniform_int_distribution<K> distribution{min, max};
+
+  size_t count = 0;
+
+  while (count != n) {
+    count += insert_unsafe(distribution(rng), {});
+  }
+}
+
+/*
+ * frees all the nodes (not thread-safe)
+ */
+template <class K, class V>
+SkipList<K, V>::~SkipList()
+{
+  for (auto node = head_; node != nullptr;) {
+    auto next = node->next[0];
+    mem::free(node);
+    node = next;
+  }
+}
+
+template <class K, class V>
+typename SkipList<K, V>::NodePtr SkipList<K, V>::find_predecessors(
+    context::Thread& thread_ctx, const K key, Predecessors& preds,
+    Predecessors& succs)
+{
+  auto pred = thread_ctx.dereference(head_);
+
+  for (size_t i = SkipNode<K, V>::MAX_HEIGHT; i-- > 0;) {
+    auto curr = thread_ctx.dereference(pred->next[i]);
+
+    while (curr->key < key) {
+      pred = curr;
+      curr = thread_ctx.dereference(pred->next[i]);
+    }
+
+    preds[i] = pred;
+    succs[i] = curr;
+  }
+
+  return succs[0];
+}
+
+template <class K, class V>
+typename SkipList<K, V>::NodePtr SkipList<K, V>::lower_bound(
+    context::Thread& thread_ctx, const K key)
+{
+  auto pred = thread_ctx.dereference(head_);
+  NodePtr curr = nullptr;
+
+  for (size_t i = SkipNode<K, V>::MAX_HEIGHT; i-- > 0;) {
+    curr = thread_ctx.dereference(pred->next[i]);
+
+    while (curr->key < key) {
+      pred = curr;
+      curr = thread_ctx.dereference(pred->next[i]);
+    }
+  }
+
+  return curr;
+}
+
+template <class K, class V>
+bool SkipList<K, V>::insert(context::Thread& thread_ctx, const K key,
+                            const V value)
+{
+  Predecessors preds;
+  Predecessors succs;
+
+restart:
+  bool inserted = false;
+  thread_ctx.reader_lock();
+
+  auto next = find_predecessors(thread_ctx, key, preds, succs);
+
+  if (next->key != key) {
+    const size_t height = random_height();
+
+    /* the same node can be the predecessor on several levels; locking it
+       again just hands us back our copy */
+    for (size_t i = 0; i < height; i++) {
+      if (!thread_ctx.try_lock(preds[i])) {
+        thread_ctx.abort();
+        goto restart;
+      }
+    }
+
+    auto node = mem::alloc<SkipNode<K, V>>(key, value, height);
+
+    for (size_t i = 0; i < height; i++) {
+      thread_ctx.assign(node->next[i], succs[i]);
+      thread_ctx.assign(preds[i]->next[i], node);
+    }
+
+    inserted = true;
+  }
+
+  thread_ctx.reader_unlock();
+  return inserted;
+}
+
+template <class K, class V>
+bool SkipList<K, V>::erase(context::Thread& thread_ctx, const K key)
+{
+  Predecessors preds;
+  Predecessors succs;
+
+restart:
+  bool found = false;
+  thread_ctx.reader_lock();
+
+  auto victim = find_predecessors(thread_ctx, key, preds, succs);
+
+  if (victim->key == key) {
+    const size_t height = victim->height;
+
+    if (!thread_ctx.try_lock(victim)) {
+      thread_ctx.abort();
+      goto restart;
+    }
+
+    for (size_t i = 0; i < height; i++) {
+      if (!thread_ctx.try_lock(preds[i])) {
+        thread_ctx.abort();
+        goto restart;
+      }
+    }
+
+    for (size_t i = 0; i < height; i++) {
+      thread_ctx.assign(preds[i]->next[i],
+                        thread_ctx.dereference(victim->next[i]));
+    }
+
+    mem::retire(thread_ctx, victim);
+    found = true;
+  }
+
+  thread_ctx.reader_unlock();
+  return found;
+}
+
+template <class K, class V>
+bool SkipList<K, V>::find(context::Thread& thread_ctx, const K key, V& value)
+{
+  thread_ctx.reader_lock();
+
+  auto node = lower_bound(thread_ctx, key);
+  const bool found = (node->key == key);
+  if (found) value = node->value;
+
+  thread_ctx.reader_unlock();
+  return found;
+}
+
+template <class K, class V>
+bool SkipList<K, V>::contains(context::Thread& thread_ctx, const K key)
+{
+  V value{};
+  return find(thread_ctx, key, value);
+}
+
+template <class K, class V>
+bool SkipList<K, V>::insert_unsafe(const K key, const V value)
+{
+  Predecessors preds;
+  auto pred = head_;
+
+  for (size_t i = SkipNode<K, V>::MAX_HEIGHT; i-- > 0;) {
+    while (pred->next[i]->key < key) pred = pred->next[i];
+    preds[i] = pred;
+  }
+
+  if (preds[0]->next[0]->key == key) return false;
+
+  const size_t height = random_height();
+  auto node = mem::alloc<SkipNode<K, V>>(key, value, height);
+
+  for (size_t i = 0; i < height; i++) {
+    node->next[i] = preds[i]->next[i];
+    preds[i]->next[i] = node;
+  }
+
+  return true;
+}
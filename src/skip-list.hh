@@ -0,0 +1,111 @@
+#ifndef SKIP_LIST_HH
+#define SKIP_LIST_HH
+
+#include <array>
+
+#include "rlu.hh"
+
+namespace rlu {
+
+template <class K, class V>
+struct SkipNode {
+  /* with p = 1/4, 16 levels are enough for billions of keys */
+  static constexpr size_t MAX_HEIGHT = 16;
+
+  K key;
+  V value;
+  size_t height;
+  std::array<SkipNode<K, V>*, MAX_HEIGHT> next;
+
+  SkipNode(const K k = {}, const V v = {}, const size_t height = 1)
+      : key(k), value(v), height(height), next{}
+  {
+  }
+};
+
+/*
+ * A skip list whose towers are updated atomically: an insert or an erase locks
+ * the predecessors on all the levels it touches and commits them together, so
+ * readers never see a half-linked tower.
+ */
+template <class K, class V>
+class SkipList {
+public:
+  using NodePtr = SkipNode<K, V>*;
+  using Predecessors = std::array<NodePtr, SkipNode<K, V>::MAX_HEIGHT>;
+
+private:
+  NodePtr head_{nullptr};
+
+  static size_t random_height();
+
+  /* fills `preds` and `succs` on every level, returns the level-0 successor */
+  NodePtr find_predecessors(context::Thread& thread_ctx, const K key,
+                            Predecessors& preds, Predecessors& succs);
+
+  /* returns the first node with a key >= `key` */
+  NodePtr lower_bound(context::Thread& thread_ctx, const K key);
+
+public:
+  SkipList();
+  SkipList(const size_t n, const K min, const K max);
+  ~SkipList();
+
+  SkipList(const SkipList<K, V>&) = delete;
+  SkipList<K, V>& operator=(const SkipList<K, V>&) = delete;
+
+  bool insert(context::Thread& thread_ctx, const K key, const V value);
+  bool erase(context::Thread& thread_ctx, const K key);
+  bool find(context::Thread& thread_ctx, const K key, V& value);
+  bool contains(context::Thread& thread_ctx, const K key);
+
+  /* set interface */
+  bool add(context::Thread& thread_ctx, const K key)
+  {
+    return insert(thread_ctx, key, {});
+  }
+
+  /* calls `fn(key, value)` on every pair with `lo <= key <= hi`, in order and
+     within a single read section; returns the number of visited pairs */
+  template <class Fn>
+  size_t for_each_range(context::Thread& thread_ctx, const K lo, const K hi,
+                        Fn&& fn);
+
+  template <class Fn>
+  size_t for_each(context::Thread& thread_ctx, Fn&& fn)
+  {
+    return for_each_range(thread_ctx, std::numeric_limits<K>::min() + 1,
+                          std::numeric_limits<K>::max() - 1, fn);
+  }
+
+  /* inserts without any synchronization (not thread-safe) */
+  bool insert_unsafe(const K key, const V value);
+
+  NodePtr head() { return head_; }
+};
+
+template <class K, class V>
+template <class Fn>
+size_t SkipList<K, V>::for_each_range(context::Thread& thread_ctx, const K lo,
+                                      const K hi, Fn&& fn)
+{
+  size_t count = 0;
+  thread_ctx.reader_lock();
+
+  for (auto node = lower_bound(thread_ctx, lo); node->key <= hi;
+       node = thread_ctx.dereference(node->next[0])) {
+    if (node->next[0] == nullptr) break;  // the tail
+
+    fn(node->key, node->value);
+    count++;
+  }
+
+  thread_ctx.reader_unlock();
+  return count;
+}
+
+template class SkipList<int32_t, int32_t>;
+
+}  // namespace rlu
+
+#endif /* SKIP_LIST_HH */
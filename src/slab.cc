@@ -0,0 +1,149 @@
+#include "slab.hh"
+
+#include <mutex>
+#include <new>
+
+#include <sys/mman.h>
+
+#include "numa.hh"
+
+using namespace std;
+using namespace rlu::mem;
+
+namespace {
+
+/* every heap ever created; heaps are never destroyed, as other threads may
+   still free objects into them */
+struct Registry {
+  mutex lock{};
+  vector<Heap*> heaps{};
+  vector<Heap*> orphans{};
+};
+
+Registry& registry()
+{
+  static auto registry = new Registry;
+  return *registry;
+}
+
+/* an mmap'd chunk, aligned to its size */
+void* map_chunk()
+{
+  const size_t size = 2 * SLAB_CHUNK_SIZE;
+  void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (region == MAP_FAILED) return nullptr;
+
+  const auto start = reinterpret_cast<uintptr_t>(region);
+  const auto chunk = (start + SLAB_CHUNK_SIZE - 1) & ~(SLAB_CHUNK_SIZE - 1);
+
+  /* trimming the slack on both sides */
+  if (chunk > start) munmap(region, chunk - start);
+  if (chunk + SLAB_CHUNK_SIZE < start + size) {
+    munmap(reinterpret_cast<void*>(chunk + SLAB_CHUNK_SIZE),
+           start + size - chunk - SLAB_CHUNK_SIZE);
+  }
+
+  return reinterpret_cast<void*>(chunk);
+}
+
+/* hands the heap over to the registry when its thread exits */
+struct HeapOwner {
+  Heap* heap;
+
+  ~HeapOwner()
+  {
+    auto& reg = registry();
+    lock_guard<mutex> guard{reg.lock};
+    reg.orphans.push_back(heap);
+  }
+};
+
+}  // namespace
+
+void AllocStats::merge(const AllocStats& other)
+{
+  allocs += other.allocs;
+  frees += other.frees;
+  remote_frees += other.remote_frees;
+  chunks += other.chunks;
+  allocated_bytes += other.allocated_bytes;
+  freed_bytes += other.freed_bytes;
+}
+
+AllocStats AllocStats::operator-(const AllocStats& other) const
+{
+  AllocStats result;
+  result.allocs = allocs - other.allocs;
+  result.frees = frees - other.frees;
+  result.remote_frees = remote_frees - other.remote_frees;
+  result.chunks = chunks - other.chunks;
+  result.allocated_bytes = allocated_bytes - other.allocated_bytes;
+  result.freed_bytes = freed_bytes - other.freed_bytes;
+  return result;
+}
+
+atomic<bool> Heap::numa_local_{false};
+
+Heap& Heap::local()
+{
+  static thread_local HeapOwner owner{[] {
+    auto& reg = registry();
+    lock_guard<mutex> guard{reg.lock};
+
+    /* adopting an orphan keeps its chunks (and free lists) in use */
+    if (!reg.orphans.empty()) {
+      auto heap = reg.orphans.back();
+      reg.orphans.pop_back();
+      return heap;
+    }
+
+    reg.heaps.push_back(new Heap);
+    return reg.heaps.back();
+  }()};
+
+  return *owner.heap;
+}
+
+void* Heap::refill(const size_t cls)
+{
+  auto& c = classes_[cls];
+
+  /* the objects the other threads gave back */
+  if (auto list = c.remote.exchange(nullptr, memory_order_acquire)) {
+    c.free = list->next;
+    return list;
+  }
+
+  auto chunk = map_chunk();
+  if (chunk == nullptr) return nullptr;
+
+  /* before the first touch, so the pages never live anywhere else */
+  if (unsigned node; numa_local_ && rlu::numa::current_node(node)) {
+    rlu::numa::bind_to_node(chunk, SLAB_CHUNK_SIZE, node);
+  }
+
+  new (chunk) ChunkHeader{this};
+  chunks_.push_back(chunk);
+  stats_.chunks++;
+
+  const size_t size = SLAB_CLASSES[cls];
+  const size_t count = (SLAB_CHUNK_SIZE - sizeof(ChunkHeader)) / size;
+
+  auto obj = reinterpret_cast<uint8_t*>(chunk) + sizeof(ChunkHeader);
+  c.bump = obj + size;
+  c.end = obj + count * size;
+
+  return obj;
+}
+
+AllocStats Heap::total_stats()
+{
+  auto& reg = registry();
+  lock_guard<mutex> guard{reg.lock};
+
+  AllocStats total;
+  for (auto heap : reg.heaps) total.merge(heap->stats_);
+  return total;
+}
@@ -0,0 +1,209 @@
+#ifndef SLAB_HH
+#define SLAB_HH
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+namespace rlu {
+
+constexpr size_t CACHELINE_SIZE = 64;
+
+namespace mem {
+
+/*
+ * A per-thread, size-class slab allocator for RLU objects. Every thread has a
+ * heap, and every heap carves its objects out of its own chunks, so the common
+ * alloc/free pair never takes a lock. The size classes are either divisors or
+ * multiples of the cache line size, so no object straddles more lines than it
+ * has to. An object freed by another thread goes back to its owner through a
+ * lock-free list, and the heap of an exited thread is handed over to the next
+ * thread that needs one. Chunks are never given back to the system. They're
+ * first touched by the thread that takes them, and can be bound to its NUMA
+ * node, too.
+ *
+ * With RLU_SYSTEM_MALLOC defined, the objects come from malloc instead (but
+ * the counters are still kept). With RLU_COMPACT_HEADERS, there are 24- and
+ * 48-byte classes, too: they straddle lines, but a small node and its header
+ * (say 16 + 8 bytes) no longer take up a 32-byte slot.
+ */
+
+#ifdef RLU_SYSTEM_MALLOC
+constexpr bool SYSTEM_MALLOC = true;
+#else
+constexpr bool SYSTEM_MALLOC = false;
+#endif
+
+constexpr size_t SLAB_CHUNK_SIZE = 64 * 1024;
+#ifdef RLU_COMPACT_HEADERS
+constexpr std::array<size_t, 10> SLAB_CLASSES{16,  24,  32,  48,  64,
+                                              128, 192, 256, 384, 512};
+#else
+constexpr std::array<size_t, 8> SLAB_CLASSES{16,  32,  64,  128,
+                                             192, 256, 384, 512};
+#endif
+constexpr size_t NO_CLASS = std::numeric_limits<size_t>::max();
+
+constexpr size_t size_class(const size_t size)
+{
+  for (size_t i = 0; i < SLAB_CLASSES.size(); i++) {
+    if (size <= SLAB_CLASSES[i]) return i;
+  }
+
+  return NO_CLASS;
+}
+
+struct AllocStats {
+  uint64_t allocs{0};
+  uint64_t frees{0};
+  uint64_t remote_frees{0};  // objects freed to another thread's heap
+  uint64_t chunks{0};        // chunks taken from the system
+
+  /* what the objects take up: a whole slot each, or what malloc was asked
+     for (without its own overhead) */
+  uint64_t allocated_bytes{0};
+  uint64_t freed_bytes{0};
+
+  uint64_t live_bytes() const { return allocated_bytes - freed_bytes; }
+
+  void merge(const AllocStats& other);
+  AllocStats operator-(const AllocStats& other) const;
+};
+
+class Heap {
+private:
+  struct FreeObject {
+    FreeObject* next;
+  };
+
+  struct alignas(CACHELINE_SIZE) SizeClass {
+    FreeObject* free{nullptr};
+    uint8_t* bump{nullptr};
+    uint8_t* end{nullptr};
+
+    /* pushed to by the other threads, drained by the owner */
+    alignas(CACHELINE_SIZE) std::atomic<FreeObject*> remote{nullptr};
+  };
+
+  /* sits in the first cache line of every chunk */
+  struct alignas(CACHELINE_SIZE) ChunkHeader {
+    Heap* owner;
+  };
+
+  std::array<SizeClass, SLAB_CLASSES.size()> classes_{};
+  std::vector<void*> chunks_{};
+  AllocStats stats_{};
+
+  static std::atomic<bool> numa_local_;
+
+  void* refill(const size_t cls);
+
+  Heap() {}
+
+public:
+  Heap(const Heap&) = delete;
+  Heap& operator=(const Heap&) = delete;
+
+  /* the calling thread's heap */
+  static Heap& local();
+
+  /* places every new chunk on the NUMA node of the thread that takes it */
+  static void set_numa_local(const bool numa_local)
+  {
+    numa_local_ = numa_local;
+  }
+
+  void* alloc(const size_t cls)
+  {
+    stats_.allocs++;
+    stats_.allocated_bytes += SLAB_CLASSES[cls];
+    auto& c = classes_[cls];
+
+    if (c.free != nullptr) {
+      auto obj = c.free;
+      c.free = obj->next;
+      return obj;
+    }
+
+    if (c.bump != c.end) {
+      auto obj = c.bump;
+      c.bump += SLAB_CLASSES[cls];
+      return obj;
+    }
+
+    return refill(cls);
+  }
+
+  void free(void* ptr, const size_t cls)
+  {
+    stats_.frees++;
+    stats_.freed_bytes += SLAB_CLASSES[cls];
+
+    auto obj = reinterpret_cast<FreeObject*>(ptr);
+    auto owner = reinterpret_cast<ChunkHeader*>(
+                     reinterpret_cast<uintptr_t>(ptr) & ~(SLAB_CHUNK_SIZE - 1))
+                     ->owner;
+
+    if (owner == this) {
+      obj->next = classes_[cls].free;
+      classes_[cls].free = obj;
+      return;
+    }
+
+    stats_.remote_frees++;
+    auto& remote = owner->classes_[cls].remote;
+    obj->next = remote.load(std::memory_order_relaxed);
+
+    while (!remote.compare_exchange_weak(obj->next, obj,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+    }
+  }
+
+  /* for objects that don't fit any class */
+  void count_alloc(const size_t size)
+  {
+    stats_.allocs++;
+    stats_.allocated_bytes += size;
+  }
+
+  void count_free(const size_t size)
+  {
+    stats_.frees++;
+    stats_.freed_bytes += size;
+  }
+
+  /* the sum over all the heaps, live or orphaned; only exact when the
+     threads are quiet */
+  static AllocStats total_stats();
+};
+
+inline void* allocate(const size_t size)
+{
+  if (const auto cls = size_class(size); !SYSTEM_MALLOC && cls != NO_CLASS) {
+    return Heap::local().alloc(cls);
+  }
+
+  Heap::local().count_alloc(size);
+  return std::malloc(size);
+}
+
+inline void deallocate(void* ptr, const size_t size)
+{
+  if (const auto cls = size_class(size); !SYSTEM_MALLOC && cls != NO_CLASS) {
+    Heap::local().free(ptr, cls);
+    return;
+  }
+
+  Heap::local().count_free(size);
+  std::free(ptr);
+}
+
+}  // namespace mem
+
+}  // namespace rlu
+
+#endif /* SLAB_HH */
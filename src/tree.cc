@@ -0,0 +1,222 @@
+#include "tree.hh"
+
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace rlu;
+
+template <class K, class V>
+Tree<K, V>::Tree()
+{
+  root_ = mem::alloc<TreeNode<K, V>>(numeric_limits<K>::max());
+}
+
+/*
+ * creates a tree with `n` random keys (not thread-safe)
+ */
+template <class K, class V>
+Tree<K, V>::Tree(const size_t n, const K min, const K max) : Tree()
+{
+  random_device dev;
+  mt19937 rng{dev()};
+  uniform_int_distribution<K> distribution{min, max};
+
+  size_t count = 0;
+
+  while (count != n) {
+    count += insert_unsafe(distribution(rng), {});
+  }
+}
+
+/*
+ * frees all the nodes (not thread-safe)
+ */
+template <class K, class V>
+Tree<K, V>::~Tree()
+{
+  vector<NodePtr> stack{root_};
+
+  while (!stack.empty()) {
+    auto node = stack.back();
+    stack.pop_back();
+
+    for (auto child : node->child) {
+      if (child != nullptr) stack.push_back(child);
+    }
+
+    mem::free(node);
+  }
+}
+
+template <class K, class V>
+bool Tree<K, V>::insert(context::Thread& thread_ctx, const K key,
+                        const V value)
+{
+restart:
+  bool inserted = false;
+  thread_ctx.reader_lock();
+
+  auto prev = thread_ctx.dereference(root_);
+  auto curr = thread_ctx.dereference(prev->child[0]);
+  size_t dir = 0;
+
+  while (curr != nullptr && curr->key != key) {
+    prev = curr;
+    dir = key > curr->key;
+    curr = thread_ctx.dereference(prev->child[dir]);
+  }
+
+  if (curr == nullptr) {
+    if (!thread_ctx.try_lock(prev)) {
+      thread_ctx.abort();
+      goto restart;
+    }
+
+    auto node = mem::alloc<TreeNode<K, V>>(key, value);
+    thread_ctx.assign(prev->child[dir], node);
+    inserted = true;
+  }
+
+  thread_ctx.reader_unlock();
+  return inserted;
+}
+
+template <class K, class V>
+bool Tree<K, V>::erase(context::Thread& thread_ctx, const K key)
+{
+restart:
+  bool found = false;
+  thread_ctx.reader_lock();
+
+  auto prev = thread_ctx.dereference(root_);
+  auto curr = thread_ctx.dereference(prev->child[0]);
+  size_t dir = 0;
+
+  while (curr != nullptr && curr->key != key) {
+    prev = curr;
+    dir = key > curr->key;
+    curr = thread_ctx.dereference(prev->child[dir]);
+  }
+
+  if (curr != nullptr) {
+    auto left = thread_ctx.dereference(curr->child[0]);
+    auto right = thread_ctx.dereference(curr->child[1]);
+
+    if (left == nullptr || right == nullptr) {
+      /* at most one child: splice it into the parent */
+      if (!thread_ctx.try_lock(prev) || !thread_ctx.try_lock(curr)) {
+        thread_ctx.abort();
+        goto restart;
+      }
+
+      thread_ctx.assign(prev->child[dir], left != nullptr ? left : right);
+      mem::retire(thread_ctx, curr);
+    }
+    else {
+      /* two children: the successor (the leftmost node of the right subtree)
+         takes curr's place, and is unlinked from where it was */
+      auto succ_prev = curr;
+      auto succ = right;
+      size_t succ_dir = 1;
+
+      for (auto next = thread_ctx.dereference(succ->child[0]);
+           next != nullptr; next = thread_ctx.dereference(succ->child[0])) {
+        succ_prev = succ;
+        succ = next;
+        succ_dir = 0;
+      }
+
+      if (!thread_ctx.try_lock(curr) || !thread_ctx.try_lock(succ_prev) ||
+          !thread_ctx.try_lock(succ)) {
+        thread_ctx.abort();
+        goto restart;
+      }
+
+      /* if the successor is curr's right child, `succ_prev` is curr's copy */
+      curr->key = succ->key;
+      curr->value = succ->value;
+      thread_ctx.assign(succ_prev->child[succ_dir],
+                        thread_ctx.dereference(succ->child[1]));
+
+      mem::retire(thread_ctx, succ);
+    }
+
+    found = true;
+  }
+
+  thread_ctx.reader_unlock();
+  return found;
+}
+
+template <class K, class V>
+bool Tree<K, V>::find(context::Thread& thread_ctx, const K key, V& value)
+{
+  thread_ctx.reader_lock();
+
+  auto node = thread_ctx.dereference(thread_ctx.dereference(root_)->child[0]);
+
+  while (node != nullptr && node->key != key) {
+    node = thread_ctx.dereference(node->child[key > node->key]);
+  }
+
+  const bool found = (node != nullptr);
+  if (found) value = node->value;
+
+  thread_ctx.reader_unlock();
+  return found;
+}
+
+template <class K, class V>
+bool Tree<K, V>::contains(context::Thread& thread_ctx, const K key)
+{
+  V value{};
+  return find(thread_ctx, key, value);
+}
+
+template <class K, class V>
+bool Tree<K, V>::lower_bound(context::Thread& thread_ctx, const K key,
+                             K& result)
+{
+  thread_ctx.reader_lock();
+
+  NodePtr candidate = nullptr;
+  auto node = thread_ctx.dereference(thread_ctx.dereference(root_)->child[0]);
+
+  while (node != nullptr) {
+    if (node->key == key) {
+      candidate = node;
+      break;
+    }
+    else if (node->key > key) {
+      candidate = node;
+      node = thread_ctx.dereference(node->child[0]);
+    }
+    else {
+      node = thread_ctx.dereference(node->child[1]);
+    }
+  }
+
+  const bool found = (candidate != nullptr);
+  if (found) result = candidate->key;
+
+  thread_ctx.reader_unlock();
+  return found;
+}
+
+template <class K, class V>
+bool Tree<K, V>::insert_unsafe(const K key, const V value)
+{
+  auto prev = root_;
+  size_t dir = 0;
+
+  for (auto curr = prev->child[0]; curr != nullptr; curr = prev->child[dir]) {
+    if (curr->key == key) return false;
+
+    prev = curr;
+    dir = key > curr->key;
+  }
+
+  prev->child[dir] = mem::alloc<TreeNode<K, V>>(key, value);
+  return true;
+}
@@ -0,0 +1,126 @@
+#ifndef TREE_HH
+#define TREE_HH
+
+#include <array>
+#include <vector>
+
+#include "rlu.hh"
+
+namespace rlu {
+
+template <class K, class V>
+struct TreeNode {
+  K key;
+  V value;
+  std::array<TreeNode<K, V>*, 2> child;  // [0] is left, [1] is right
+
+  TreeNode(const K k = {}, const V v = {}, TreeNode<K, V>* left = nullptr,
+           TreeNode<K, V>* right = nullptr)
+      : key(k), value(v), child{left, right}
+  {
+  }
+};
+
+/*
+ * An internal binary search tree in the style of Citrus (Arbel & Attiya,
+ * PODC'14), as ported to RLU in the paper. Like Citrus, it does no
+ * rebalancing. Removing a node with two children moves its successor's
+ * key up and unlinks the successor in the same write section, so readers
+ * never miss a key that is being moved.
+ */
+template <class K, class V>
+class Tree {
+public:
+  using NodePtr = TreeNode<K, V>*;
+
+private:
+  NodePtr root_{nullptr};  // a sentinel, the whole tree is its left child
+
+public:
+  Tree();
+  Tree(const size_t n, const K min, const K max);
+  ~Tree();
+
+  Tree(const Tree<K, V>&) = delete;
+  Tree<K, V>& operator=(const Tree<K, V>&) = delete;
+
+  bool insert(context::Thread& thread_ctx, const K key, const V value);
+  bool erase(context::Thread& thread_ctx, const K key);
+  bool find(context::Thread& thread_ctx, const K key, V& value);
+  bool contains(context::Thread& thread_ctx, const K key);
+
+  /* finds the smallest key that is >= `key` */
+  bool lower_bound(context::Thread& thread_ctx, const K key, K& result);
+
+  /* set interface */
+  bool add(context::Thread& thread_ctx, const K key)
+  {
+    return insert(thread_ctx, key, {});
+  }
+
+  /* calls `fn(key, value)` on every pair with `lo <= key <= hi`, in order and
+     within a single read section; returns the number of visited pairs */
+  template <class Fn>
+  size_t for_each_range(context::Thread& thread_ctx, const K lo, const K hi,
+                        Fn&& fn);
+
+  template <class Fn>
+  size_t for_each(context::Thread& thread_ctx, Fn&& fn)
+  {
+    return for_each_range(thread_ctx, std::numeric_limits<K>::min(),
+                          std::numeric_limits<K>::max() - 1, fn);
+  }
+
+  /* inserts without any synchronization (not thread-safe) */
+  bool insert_unsafe(const K key, const V value);
+
+  NodePtr root() { return root_; }
+};
+
+template <class K, class V>
+template <class Fn>
+size_t Tree<K, V>::for_each_range(context::Thread& thread_ctx, const K lo,
+                                  const K hi, Fn&& fn)
+{
+  static thread_local std::vector<NodePtr> stack;
+  stack.clear();
+
+  size_t count = 0;
+  thread_ctx.reader_lock();
+
+  auto node = thread_ctx.dereference(thread_ctx.dereference(root_)->child[0]);
+
+  while (node != nullptr || !stack.empty()) {
+    if (node != nullptr) {
+      if (node->key < lo) {
+        node = thread_ctx.dereference(node->child[1]);  // all of it is < lo
+      }
+      else {
+        stack.push_back(node);
+        node = (node->key > lo) ? thread_ctx.dereference(node->child[0])
+                                : nullptr;
+      }
+
+      continue;
+    }
+
+    node = stack.back();
+    stack.pop_back();
+
+    if (node->key > hi) break;
+
+    fn(node->key, node->value);
+    count++;
+
+    node = thread_ctx.dereference(node->child[1]);
+  }
+
+  thread_ctx.reader_unlock();
+  return count;
+}
+
+template class Tree<int32_t, int32_t>;
+
+}  // namespace rlu
+
+#endif /* TREE_HH */
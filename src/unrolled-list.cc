@@ -0,0 +1,277 @@
+#include "unrolled-list.hh"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace rlu;
+
+namespace {
+
+template <class T>
+size_t block_rank(const UnrolledNode<T>* node, const T value)
+{
+  size_t i = 0;
+  while (i < node->count && node->keys[i] < value) i++;
+  return i;
+}
+
+/* compares `value` with the whole block at once, and counts the smaller
+   keys among the valid ones; the block is sorted, so that's the rank. The
+   block isn't a multiple of the vector width, so the last load overlaps the
+   one before it rather than reading past the keys. */
+size_t block_rank(const UnrolledNode<int32_t>* node, const int32_t value)
+{
+  constexpr size_t N = UnrolledNode<int32_t>::CAPACITY;
+  static_assert(N > 8 && N <= 12, "the loads below cover 9 to 12 keys");
+
+  const int32_t* keys = node->keys.data();
+  uint32_t mask;
+
+#if defined(__AVX2__)
+  const auto v = _mm256_set1_epi32(value);
+
+  auto less = [&v](const int32_t* block) {
+    const auto k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    return static_cast<uint32_t>(
+        _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, k))));
+  };
+
+  mask = less(keys) | (less(keys + N - 8) << (N - 8));
+#elif defined(__SSE2__)
+  const auto v = _mm_set1_epi32(value);
+
+  auto less = [&v](const int32_t* block) {
+    const auto k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+    return static_cast<uint32_t>(
+        _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(k, v))));
+  };
+
+  mask = less(keys) | (less(keys + 4) << 4) | (less(keys + N - 4) << (N - 4));
+#else
+  mask = 0;
+  for (size_t i = 0; i < N; i++) mask |= uint32_t{keys[i] < value} << i;
+#endif
+
+  mask &= (1u << node->count) - 1;
+  return __builtin_popcount(mask);
+}
+
+}  // namespace
+
+template <class T>
+size_t UnrolledList<T>::rank(const UnrolledNode<T>* node, const T value)
+{
+  return block_rank(node, value);
+}
+
+template <class T>
+UnrolledList<T>::UnrolledList() : head_(mem::alloc<UnrolledNode<T>>())
+{
+}
+
+/*
+ * creates a list with `n` random numbers (not thread-safe); the nodes are
+ * filled to 3/4, to leave some room for the insertions that follow
+ */
+template <class T>
+UnrolledList<T>::UnrolledList(const size_t n, const T min, const T max)
+    : UnrolledList()
+{
+  random_device dev;
+  mt19937 rng{dev()};
+  uniform_int_distribution<T> distribution{min, max};
+
+  vector<T> values;
+
+  while (values.size() != n) {
+    while (values.size() != n) values.push_back(distribution(rng));
+
+    sort(values.begin(), values.end());
+    values.erase(unique(values.begin(), values.end()), values.end());
+  }
+
+  constexpr size_t FILL = CAPACITY * 3 / 4;
+  auto tail = head_;
+
+  for (size_t i = 0; i < values.size(); i += FILL) {
+    auto node = mem::alloc<UnrolledNode<T>>();
+    node->count = std::min(FILL, values.size() - i);
+    copy_n(values.begin() + i, node->count, node->keys.begin());
+
+    tail->next = node;
+    tail = node;
+  }
+}
+
+/*
+ * frees all the nodes (not thread-safe)
+ */
+template <class T>
+UnrolledList<T>::~UnrolledList()
+{
+  for (auto node = head_; node != nullptr;) {
+    auto next = node->next;
+    mem::free(node);
+    node = next;
+  }
+}
+
+template <class T>
+typename UnrolledList<T>::NodePtr UnrolledList<T>::find_node(
+    context::Thread& thread_ctx, const T value, NodePtr& prev)
+{
+  prev = thread_ctx.dereference(head_);
+  auto node = thread_ctx.dereference(prev->next);
+
+  /* the first node whose last key isn't smaller than `value`, or the last */
+  while (node != nullptr && node->next != nullptr &&
+         node->keys[node->count - 1] < value) {
+    prev = node;
+    node = thread_ctx.dereference(node->next);
+  }
+
+  return node;
+}
+
+template <class T>
+bool UnrolledList<T>::add(context::Thread& thread_ctx, const T value)
+{
+restart:
+  thread_ctx.reader_lock();
+
+  NodePtr prev;
+  auto node = find_node(thread_ctx, value, prev);
+
+  if (node == nullptr) {
+    /* the list is empty */
+    if (!thread_ctx.try_lock(prev)) {
+      thread_ctx.abort();
+      goto restart;
+    }
+
+    auto created = mem::alloc<UnrolledNode<T>>();
+    created->keys[0] = value;
+    created->count = 1;
+    thread_ctx.assign(prev->next, created);
+
+    thread_ctx.reader_unlock();
+    return true;
+  }
+
+  size_t i = rank(node, value);
+
+  if (i < node->count && node->keys[i] == value) {
+    thread_ctx.reader_unlock();
+    return false;
+  }
+
+  if (!thread_ctx.try_lock(node)) {
+    thread_ctx.abort();
+    goto restart;
+  }
+
+  if (node->count == CAPACITY) {
+    /* moves the upper half to a new node, which isn't reachable before the
+       commit, and so needs no lock of its own */
+    constexpr size_t HALF = CAPACITY / 2;
+
+    auto upper = mem::alloc<UnrolledNode<T>>();
+    copy(node->keys.begin() + HALF, node->keys.end(), upper->keys.begin());
+    upper->count = CAPACITY - HALF;
+    thread_ctx.assign(upper->next, thread_ctx.dereference(node->next));
+
+    node->count = HALF;
+    thread_ctx.assign(node->next, upper);
+
+    if (i > HALF) {
+      node = upper;
+      i -= HALF;
+    }
+  }
+
+  copy_backward(node->keys.begin() + i, node->keys.begin() + node->count,
+                node->keys.begin() + node->count + 1);
+  node->keys[i] = value;
+  node->count++;
+
+  thread_ctx.reader_unlock();
+  return true;
+}
+
+template <class T>
+bool UnrolledList<T>::erase(context::Thread& thread_ctx, const T value)
+{
+restart:
+  thread_ctx.reader_lock();
+
+  NodePtr prev;
+  auto node = find_node(thread_ctx, value, prev);
+  const size_t i = node ? rank(node, value) : 0;
+
+  if (node == nullptr || i == node->count || node->keys[i] != value) {
+    thread_ctx.reader_unlock();
+    return false;
+  }
+
+  if (node->count == 1) {
+    /* the last key goes, and so does the node */
+    if (!thread_ctx.try_lock(prev) || !thread_ctx.try_lock(node)) {
+      thread_ctx.abort();
+      goto restart;
+    }
+
+    thread_ctx.assign(prev->next, thread_ctx.dereference(node->next));
+    mem::retire(thread_ctx, node);
+
+    thread_ctx.reader_unlock();
+    return true;
+  }
+
+  if (!thread_ctx.try_lock(node)) {
+    thread_ctx.abort();
+    goto restart;
+  }
+
+  copy(node->keys.begin() + i + 1, node->keys.begin() + node->count,
+       node->keys.begin() + i);
+  node->count--;
+
+  /* if the successor's keys fit in here too, they move over */
+  auto next = thread_ctx.dereference(node->next);
+
+  if (next != nullptr && node->count + next->count <= MERGE_THRESHOLD) {
+    if (!thread_ctx.try_lock(next)) {
+      thread_ctx.abort();
+      goto restart;
+    }
+
+    copy_n(next->keys.begin(), next->count,
+           node->keys.begin() + node->count);
+    node->count += next->count;
+    thread_ctx.assign(node->next, thread_ctx.dereference(next->next));
+    mem::retire(thread_ctx, next);
+  }
+
+  thread_ctx.reader_unlock();
+  return true;
+}
+
+template <class T>
+bool UnrolledList<T>::contains(context::Thread& thread_ctx, const T value)
+{
+  thread_ctx.reader_lock();
+
+  NodePtr prev;
+  const auto node = find_node(thread_ctx, value, prev);
+  const size_t i = node ? rank(node, value) : 0;
+  const bool found = node && i < node->count && node->keys[i] == value;
+
+  thread_ctx.reader_unlock();
+  return found;
+}
@@ -0,0 +1,114 @@
+#ifndef UNROLLED_LIST_HH
+#define UNROLLED_LIST_HH
+
+#include <array>
+#include <limits>
+
+#include "rlu.hh"
+
+namespace rlu {
+
+/* a node and its ObjectHeader fill one cache line, which is a slot of the
+   slab's 64-byte class, and so never straddles two lines */
+template <class T>
+struct UnrolledNode {
+  static constexpr size_t CAPACITY =
+      (CACHELINE_SIZE - sizeof(ObjectHeader) - sizeof(void*) -
+       sizeof(uint32_t)) /
+      sizeof(T);
+
+  /* sorted; only the first `count` are valid */
+  std::array<T, CAPACITY> keys{};
+  uint32_t count{0};
+  UnrolledNode<T>* next{nullptr};
+};
+
+static_assert(sizeof(ObjectHeader) + sizeof(UnrolledNode<int32_t>) ==
+                  CACHELINE_SIZE,
+              "an unrolled node takes exactly one cache line");
+
+/*
+ * A sorted set whose nodes hold a block of keys each, so a traversal takes a
+ * cache miss (and an RLU header) per block rather than per key. A node is
+ * searched with SIMD compares; a full node is split in two, and a sparse one
+ * absorbs its successor, each as a single RLU update. Every node after the
+ * head (an empty sentinel) holds at least one key.
+ */
+template <class T>
+class UnrolledList {
+public:
+  using NodePtr = UnrolledNode<T>*;
+
+  static constexpr size_t CAPACITY = UnrolledNode<T>::CAPACITY;
+
+  /* two neighbours are merged when their keys fit in half a node */
+  static constexpr size_t MERGE_THRESHOLD = CAPACITY / 2;
+
+private:
+  NodePtr head_{nullptr};
+
+  /* returns the node that holds, or would hold, `value` (nullptr if the list
+     is empty), and sets `prev` to its predecessor */
+  NodePtr find_node(context::Thread& thread_ctx, const T value, NodePtr& prev);
+
+public:
+  UnrolledList();
+  UnrolledList(const size_t n, const T min, const T max);
+  ~UnrolledList();
+
+  UnrolledList(const UnrolledList<T>&) = delete;
+  UnrolledList<T>& operator=(const UnrolledList<T>&) = delete;
+
+  bool add(context::Thread& thread_ctx, const T value);
+  bool erase(context::Thread& thread_ctx, const T value);
+  bool contains(context::Thread& thread_ctx, const T value);
+
+  /* calls `fn(value)` on every value in [lo, hi], in order and within a
+     single read section; returns the number of visited values */
+  template <class Fn>
+  size_t for_each_range(context::Thread& thread_ctx, const T lo, const T hi,
+                        Fn&& fn);
+
+  template <class Fn>
+  size_t for_each(context::Thread& thread_ctx, Fn&& fn)
+  {
+    return for_each_range(thread_ctx, std::numeric_limits<T>::min(),
+                          std::numeric_limits<T>::max(), fn);
+  }
+
+  /* the number of keys in `node` that are smaller than `value` */
+  static size_t rank(const UnrolledNode<T>* node, const T value);
+
+  NodePtr head() { return head_; }
+};
+
+template <class T>
+template <class Fn>
+size_t UnrolledList<T>::for_each_range(context::Thread& thread_ctx,
+                                       const T lo, const T hi, Fn&& fn)
+{
+  size_t count = 0;
+  thread_ctx.reader_lock();
+
+  NodePtr prev;
+  auto node = find_node(thread_ctx, lo, prev);
+
+  for (size_t i = node ? rank(node, lo) : 0; node != nullptr;
+       node = thread_ctx.dereference(node->next), i = 0) {
+    for (; i < node->count && node->keys[i] <= hi; i++) {
+      fn(node->keys[i]);
+      count++;
+    }
+
+    if (i < node->count) break;  // went past `hi`
+  }
+
+  thread_ctx.reader_unlock();
+  return count;
+}
+
+template class UnrolledList<int32_t>;
+
+}  // namespace rlu
+
+#endif /* UNROLLED_LIST_HH */
@@ -0,0 +1,100 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "rlu.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+/*
+ * A reader has to keep seeing the same snapshot for as long as its section
+ * lasts, even if the committer finishes one of its logs in the meantime. The
+ * schedule below has the committer do that while a writer is waiting for the
+ * reader to leave its section.
+ */
+
+constexpr size_t ROUNDS = 20;
+
+struct Object {
+  uint64_t value{0};
+};
+
+int main(const int, char*[])
+{
+  rlu::context::Global global_ctx;
+
+  auto shared = rlu::mem::alloc<Object>();
+  auto own = rlu::mem::alloc<Object>();
+
+  for (size_t round = 0; round < ROUNDS; round++) {
+    const auto start = steady_clock::now();
+    vector<thread> threads;
+
+    /* keeps the committer's grace period open for a while */
+    threads.emplace_back([&] {
+      auto& ctx = global_ctx.register_thread();
+
+      ctx.reader_lock();
+      this_thread::sleep_until(start + 50ms);
+      ctx.reader_unlock();
+
+      global_ctx.unregister_thread(ctx);
+    });
+
+    /* seals a log, and then reads `shared` twice in a single section */
+    threads.emplace_back([&] {
+      auto& ctx = global_ctx.register_thread(rlu::context::CommitMode::Async);
+
+      this_thread::sleep_until(start + 5ms);
+      ctx.reader_lock();
+
+      auto obj = ctx.dereference(own);
+      if (!ctx.try_lock(obj)) throw runtime_error("own object is locked");
+      obj->value++;
+
+      ctx.reader_unlock();
+
+      this_thread::sleep_until(start + 10ms);
+      ctx.reader_lock();
+
+      const uint64_t before = ctx.dereference(shared)->value;
+      this_thread::sleep_until(start + 100ms);
+      const uint64_t after = ctx.dereference(shared)->value;
+
+      ctx.reader_unlock();
+
+      if (before != after) throw runtime_error("inconsistent snapshot");
+      global_ctx.unregister_thread(ctx);
+    });
+
+    /* updates `shared`, and has to wait for the reader above */
+    threads.emplace_back([&] {
+      auto& ctx = global_ctx.register_thread();
+
+      this_thread::sleep_until(start + 20ms);
+      ctx.reader_lock();
+
+      auto obj = ctx.dereference(shared);
+      if (!ctx.try_lock(obj)) throw runtime_error("shared object is locked");
+      obj->value++;
+
+      ctx.reader_unlock();
+      global_ctx.unregister_thread(ctx);
+    });
+
+    for (auto& t : threads) t.join();
+    cerr << '.';
+  }
+
+  cerr << endl;
+
+  if (shared->value != ROUNDS || own->value != ROUNDS) {
+    throw runtime_error("lost updates");
+  }
+
+  rlu::mem::free(shared);
+  rlu::mem::free(own);
+  return EXIT_SUCCESS;
+}
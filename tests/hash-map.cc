@@ -0,0 +1,124 @@
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+
+#include "hash-map.hh"
+#include "rlu.hh"
+
+using namespace std;
+
+constexpr size_t NUM_THREADS = 32;
+constexpr size_t NUM_WRITERS = 8;
+constexpr int32_t KEYS_PER_WRITER = 2000;
+
+int32_t key_of(const size_t writer, const int32_t i)
+{
+  return i * NUM_WRITERS + writer;
+}
+
+int main(const int, char*[])
+{
+  vector<thread> threads;
+  array<atomic<int32_t>, NUM_WRITERS> progress;
+  for (auto& p : progress) p = -1;
+
+  /* starting with a tiny table, so it has to grow under the readers' feet */
+  rlu::HashMap<int32_t, int32_t> map{4};
+  rlu::context::Global global_ctx;
+
+  for (size_t i = 0; i < NUM_THREADS; i++) {
+    threads.emplace_back(
+        [&global_ctx, &map, &progress](const size_t thread_id) {
+          auto& thread_ctx = global_ctx.register_thread();
+
+          if (thread_id < NUM_WRITERS) {
+            for (int32_t i = 0; i < KEYS_PER_WRITER; i++) {
+              const auto key = key_of(thread_id, i);
+              if (!map.insert(thread_ctx, key, 2 * key)) {
+                throw runtime_error("duplicate insert");
+              }
+
+              progress[thread_id] = i;
+              if (i % 500 == 0) cerr << 'W';
+            }
+
+            /* only the even ones survive */
+            for (int32_t i = 1; i < KEYS_PER_WRITER; i += 2) {
+              if (!map.erase(thread_ctx, key_of(thread_id, i))) {
+                throw runtime_error("missing key");
+              }
+            }
+          }
+          else /* it's a reader */ {
+            mt19937 rng{static_cast<uint32_t>(thread_id)};
+
+            for (size_t i = 0; i < 20000; i++) {
+              const size_t writer = rng() % NUM_WRITERS;
+              const int32_t last = progress[writer];
+              if (last < 0) continue;
+
+              const auto key = key_of(writer, (rng() % (last + 1)) & ~1);
+              int32_t value;
+
+              if (!map.find(thread_ctx, key, value) || value != 2 * key) {
+                throw runtime_error("lost key during resize");
+              }
+
+              if (i % 5000 == 0) cerr << 'R';
+            }
+          }
+
+          global_ctx.unregister_thread(thread_ctx);
+        },
+        i);
+  }
+
+  for (size_t i = 0; i < NUM_THREADS; i++) {
+    threads[i].join();
+  }
+
+  cerr << endl;
+
+  auto& thread_ctx = global_ctx.register_thread();
+
+  if (map.size() != NUM_WRITERS * KEYS_PER_WRITER / 2 ||
+      map.bucket_count(thread_ctx) <= 4) {
+    throw runtime_error("unexpected size");
+  }
+
+  for (size_t w = 0; w < NUM_WRITERS; w++) {
+    for (int32_t i = 0; i < KEYS_PER_WRITER; i++) {
+      if (map.contains(thread_ctx, key_of(w, i)) != (i % 2 == 0)) {
+        throw runtime_error("inconsistent map");
+      }
+    }
+  }
+
+  /* shrinking it back down keeps every key; locking all the buckets of the
+     big table takes a write set that spans many write log segments */
+  map.resize(thread_ctx, 1 << 15);
+  map.resize(thread_ctx, 16);
+
+  for (size_t w = 0; w < NUM_WRITERS; w++) {
+    for (int32_t i = 0; i < KEYS_PER_WRITER; i += 2) {
+      if (!map.contains(thread_ctx, key_of(w, i))) {
+        throw runtime_error("lost key after shrinking");
+      }
+    }
+  }
+
+  /* a big map keeps growing, and keeps taking keys */
+  rlu::HashMap<int32_t, int32_t> big;
+  constexpr int32_t BIG_SIZE = 1 << 17;
+
+  for (int32_t i = 0; i < BIG_SIZE; i++) big.insert(thread_ctx, i, i);
+
+  if (big.size() != BIG_SIZE || !big.contains(thread_ctx, BIG_SIZE - 1)) {
+    throw runtime_error("lost keys in a big map");
+  }
+
+  return EXIT_SUCCESS;
+}
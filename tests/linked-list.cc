@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <random>
+#include <set>
 #include <thread>
 
 #include "list.hh"
@@ -19,22 +21,20 @@ int32_t randint()
   return distribution(rng);
 }
 
-int main(const int, char*[])
+void run(const rlu::context::ClockSource clock_source)
 {
   vector<thread> threads;
 
   rlu::List<int32_t> list;
-  rlu::context::Global global_ctx;
-
-  for (size_t i = 0; i < NUM_THREADS; i++) {
-    global_ctx.threads.emplace_back(
-        make_unique<rlu::context::Thread>(i, global_ctx));
-  }
+  rlu::context::Global global_ctx{false, clock_source};
 
   for (size_t i = 0; i < NUM_THREADS; i++) {
     threads.emplace_back(
         [&global_ctx, &list](const size_t thread_id, const bool is_reader) {
-          auto& thread_ctx = *global_ctx.threads[thread_id];
+          /* some of the writers commit in the background */
+          auto& thread_ctx = global_ctx.register_thread(
+              thread_id % 8 == 2 ? rlu::context::CommitMode::Async
+                                 : rlu::context::CommitMode::Immediate);
 
           this_thread::sleep_for(chrono::milliseconds{100 * thread_id / 8});
 
@@ -60,15 +60,47 @@ int main(const int, char*[])
 
               thread_ctx.reader_unlock();
 
+              /* a range scan sees a sorted snapshot, within its bounds */
+              const int32_t lo = randint();
+              const int32_t hi = lo + 512;
+              int32_t last = numeric_limits<int32_t>::min();
+              size_t visited = 0;
+
+              const size_t count = list.for_each_range(
+                  thread_ctx, lo, hi, [&](const int32_t value) {
+                    if (value < lo || value > hi || value <= last) {
+                      throw runtime_error("inconsistent range scan");
+                    }
+
+                    last = value;
+                    visited++;
+                  });
+
+              if (count != visited) throw runtime_error("wrong scan count");
+
               if (i % 100 == 0) cerr << 'R';
             }
           }
           else /* it's a writer */ {
             for (int i = 0; i < 1000; i++) {
-              list.add(thread_ctx, randint());
+              /* some of the writers add sorted batches instead */
+              if (thread_id % 8 == 1) {
+                vector<int32_t> batch(16);
+                for (auto& value : batch) value = randint();
+                sort(batch.begin(), batch.end());
+
+                list.add_batch(thread_ctx, batch);
+                i += batch.size() - 1;
+              }
+              else {
+                list.add(thread_ctx, randint());
+              }
+
               if (i % 100 == 0) cerr << 'W';
             }
           }
+
+          global_ctx.unregister_thread(thread_ctx);
         },
         i, i % 32);
   }
@@ -79,5 +111,88 @@ int main(const int, char*[])
 
   cerr << endl;
 
+  /* nothing is ever erased, and the whole list is in range */
+  auto& thread_ctx = global_ctx.register_thread();
+  const size_t total = list.count_range(thread_ctx, -2048, 2048);
+
+  if (list.for_each(thread_ctx, [](const int32_t) {}) != total ||
+      list.count_range(thread_ctx, 1, 0) != 0) {
+    throw runtime_error("inconsistent count");
+  }
+
+  /* erasing every other value in a batch, and adding them back */
+  vector<int32_t> values, odd;
+  vector<bool> found;
+  list.for_each(thread_ctx,
+                [&values](const int32_t value) { values.push_back(value); });
+
+  for (size_t i = 1; i < values.size(); i += 2) odd.push_back(values[i]);
+
+  if (list.contains_batch(thread_ctx, values, found) != values.size() ||
+      list.erase_batch(thread_ctx, odd) != odd.size() ||
+      list.count_range(thread_ctx, -2048, 2048) != total - odd.size() ||
+      list.contains_batch(thread_ctx, values, found) != total - odd.size() ||
+      found[1] || !found[0] || list.add_batch(thread_ctx, odd) != odd.size() ||
+      list.count_range(thread_ctx, -2048, 2048) != total) {
+    throw runtime_error("inconsistent batch");
+  }
+
+  /* interleaved lookups of unsorted keys, half of them missing */
+  vector<int32_t> lookups;
+  for (size_t i = 0; i < values.size(); i++) {
+    lookups.push_back(values[(i * 7919) % values.size()]);
+    lookups.push_back(numeric_limits<int32_t>::max() - 1 - i);
+  }
+
+  if (list.contains_many(thread_ctx, lookups, found) != values.size()) {
+    throw runtime_error("inconsistent lookups");
+  }
+
+  for (size_t i = 0; i < lookups.size(); i++) {
+    if (found[i] != (i % 2 == 0)) throw runtime_error("wrong lookup");
+  }
+
+  global_ctx.unregister_thread(thread_ctx);
+}
+
+/* a bulk load keeps every distinct key once, in order, whatever the input */
+void check_bulk_load()
+{
+  vector<int32_t> values(300000);
+  for (auto& value : values) value = randint() * 1024 + randint();
+
+  set<int32_t> expected{values.begin(), values.end()};
+  rlu::List<int32_t> list{values};
+
+  rlu::context::Global global_ctx;
+  auto& thread_ctx = global_ctx.register_thread();
+  auto it = expected.begin();
+
+  const size_t count = list.for_each(thread_ctx, [&](const int32_t value) {
+    if (it == expected.end() || value != *it++) {
+      throw runtime_error("inconsistent bulk load");
+    }
+  });
+
+  const auto in_range =
+      distance(expected.lower_bound(0), expected.upper_bound(1023));
+
+  if (count != expected.size() ||
+      list.count_range(thread_ctx, 0, 1023) != static_cast<size_t>(in_range)) {
+    throw runtime_error("inconsistent bulk load");
+  }
+
+  global_ctx.unregister_thread(thread_ctx);
+}
+
+int main(const int, char*[])
+{
+  check_bulk_load();
+  run(rlu::context::ClockSource::Logical);
+
+  if (rlu::ordo::available()) {
+    run(rlu::context::ClockSource::Ordo);
+  }
+
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+
+#include "rlu.hh"
+#include "skip-list.hh"
+
+using namespace std;
+
+constexpr size_t NUM_THREADS = 32;
+
+int32_t randint()
+{
+  static thread_local random_device dev;
+  static thread_local mt19937 rng{dev()};
+  uniform_int_distribution<int32_t> distribution{-4096, 4096};
+
+  return distribution(rng);
+}
+
+int main(const int, char*[])
+{
+  vector<thread> threads;
+
+  rlu::SkipList<int32_t, int32_t> list;
+  rlu::context::Global global_ctx;
+
+  for (size_t i = 0; i < NUM_THREADS; i++) {
+    threads.emplace_back(
+        [&global_ctx, &list](const size_t, const bool is_reader) {
+          auto& thread_ctx = global_ctx.register_thread();
+
+          if (is_reader) {
+            for (size_t i = 0; i < 200; i++) {
+              int64_t last = numeric_limits<int64_t>::min();
+
+              list.for_each(thread_ctx, [&last](const int32_t key,
+                                                const int32_t value) {
+                if (key <= last || value != -key) {
+                  throw runtime_error("inconsistent skip list");
+                }
+
+                last = key;
+              });
+
+              if (i % 50 == 0) cerr << 'R';
+            }
+          }
+          else /* it's a writer */ {
+            for (int i = 0; i < 2000; i++) {
+              const auto key = randint();
+
+              if (i % 3) {
+                list.insert(thread_ctx, key, -key);
+              }
+              else {
+                list.erase(thread_ctx, key);
+              }
+
+              if (i % 500 == 0) cerr << 'W';
+            }
+          }
+
+          global_ctx.unregister_thread(thread_ctx);
+        },
+        i, i % 4 == 0);
+  }
+
+  for (size_t i = 0; i < NUM_THREADS; i++) {
+    threads[i].join();
+  }
+
+  cerr << endl;
+
+  /* every level has to be a sorted subsequence of the one below it */
+  constexpr auto MAX_HEIGHT = rlu::SkipNode<int32_t, int32_t>::MAX_HEIGHT;
+
+  for (size_t level = 1; level < MAX_HEIGHT; level++) {
+    auto below = list.head();
+
+    for (auto node = list.head(); node; node = node->next[level]) {
+      while (below != node) {
+        below = below->next[level - 1];
+        if (below == nullptr) throw runtime_error("broken tower");
+      }
+
+      if (node->height <= level) throw runtime_error("broken tower");
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
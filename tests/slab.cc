@@ -0,0 +1,113 @@
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "rlu.hh"
+
+using namespace std;
+using namespace rlu;
+
+constexpr size_t NUM_THREADS = 8;
+constexpr size_t OBJECTS_PER_THREAD = 20000;
+
+struct Object {
+  size_t size;
+  uint8_t* data;
+};
+
+void fill(const Object& obj, const uint8_t byte)
+{
+  memset(obj.data, byte, obj.size);
+}
+
+void check(const Object& obj, const uint8_t byte)
+{
+  for (size_t i = 0; i < obj.size; i++) {
+    if (obj.data[i] != byte) throw runtime_error("overlapping objects");
+  }
+}
+
+int main(const int, char*[])
+{
+  vector<thread> threads;
+  vector<vector<Object>> objects(NUM_THREADS);
+
+  const auto before = mem::Heap::total_stats();
+
+  /* every thread allocates objects of all the sizes */
+  for (size_t i = 0; i < NUM_THREADS; i++) {
+    threads.emplace_back(
+        [&objects](const size_t thread_id) {
+          for (size_t j = 0; j < OBJECTS_PER_THREAD; j++) {
+            const size_t size = 8 + (j * 7) % 600;  // some don't fit a class
+            Object obj{size, static_cast<uint8_t*>(mem::allocate(size))};
+
+            /* malloc makes no such promise */
+            if (!mem::SYSTEM_MALLOC && size >= 64 && size <= 512 &&
+                reinterpret_cast<uintptr_t>(obj.data) % 64 != 0) {
+              throw runtime_error("misaligned object");
+            }
+
+            fill(obj, thread_id + 1);
+            objects[thread_id].push_back(obj);
+          }
+        },
+        i);
+  }
+
+  for (auto& t : threads) t.join();
+  threads.clear();
+
+  /* the threads are gone; the next ones free their neighbours' even objects
+     (remotely, into the orphaned heaps) and allocate some more (adopting
+     them), while the odd objects have to stay intact */
+  for (size_t i = 0; i < NUM_THREADS; i++) {
+    threads.emplace_back(
+        [&objects](const size_t thread_id) {
+          const size_t victim = (thread_id + 1) % NUM_THREADS;
+          auto& theirs = objects[victim];
+
+          for (size_t j = 0; j < theirs.size(); j += 2) {
+            check(theirs[j], victim + 1);
+            mem::deallocate(theirs[j].data, theirs[j].size);
+          }
+
+          vector<Object> ours;
+
+          for (size_t j = 0; j < OBJECTS_PER_THREAD; j++) {
+            const size_t size = 8 + (j * 13) % 500;
+            ours.push_back({size, static_cast<uint8_t*>(mem::allocate(size))});
+            fill(ours.back(), 0xff);
+          }
+
+          for (auto& obj : ours) {
+            check(obj, 0xff);
+            mem::deallocate(obj.data, obj.size);
+          }
+        },
+        i);
+  }
+
+  for (auto& t : threads) t.join();
+
+  for (size_t i = 0; i < NUM_THREADS; i++) {
+    for (size_t j = 1; j < objects[i].size(); j += 2) {
+      check(objects[i][j], i + 1);
+      mem::deallocate(objects[i][j].data, objects[i][j].size);
+    }
+  }
+
+  const auto stats = mem::Heap::total_stats() - before;
+
+  /* with malloc, there are no heaps to free remotely into */
+  if (stats.allocs != stats.frees ||
+      (!mem::SYSTEM_MALLOC && stats.remote_frees == 0)) {
+    throw runtime_error("unexpected allocation counts");
+  }
+
+  cerr << stats.allocs << " allocs, " << stats.remote_frees
+       << " remote frees, " << stats.chunks << " chunks" << endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+
+#include "rlu.hh"
+#include "tree.hh"
+
+using namespace std;
+
+constexpr size_t NUM_THREADS = 32;
+constexpr size_t NUM_WRITERS = 8;
+constexpr int32_t KEYS_PER_WRITER = 2000;
+
+int32_t key_of(const size_t writer, const int32_t i)
+{
+  // scattered, so that the tree doesn't degenerate into a list
+  return (i * 7919 % KEYS_PER_WRITER) * NUM_WRITERS + writer;
+}
+
+int main(const int, char*[])
+{
+  vector<thread> threads;
+  array<atomic<int32_t>, NUM_WRITERS> progress;
+  for (auto& p : progress) p = -1;
+
+  rlu::Tree<int32_t, int32_t> tree;
+  rlu::context::Global global_ctx;
+
+  for (size_t i = 0; i < NUM_THREADS; i++) {
+    threads.emplace_back(
+        [&global_ctx, &tree, &progress](const size_t thread_id) {
+          auto& thread_ctx = global_ctx.register_thread();
+
+          if (thread_id < NUM_WRITERS) {
+            /* the writers fight over the same nodes with every policy, each
+               with and without group commit */
+            thread_ctx.set_contention_policy(
+                static_cast<rlu::context::ContentionPolicy>(thread_id % 4));
+            thread_ctx.set_group_commit((thread_id / 4) % 2);
+
+            for (int32_t i = 0; i < KEYS_PER_WRITER; i++) {
+              const auto key = key_of(thread_id, i);
+              tree.insert(thread_ctx, key, -key);
+              progress[thread_id] = i;
+              if (i % 500 == 0) cerr << 'W';
+            }
+
+            /* erasing the odd ones moves successors around the even ones */
+            for (int32_t i = 1; i < KEYS_PER_WRITER; i += 2) {
+              if (!tree.erase(thread_ctx, key_of(thread_id, i))) {
+                throw runtime_error("missing key");
+              }
+            }
+          }
+          else /* it's a reader */ {
+            mt19937 rng{static_cast<uint32_t>(thread_id)};
+
+            for (size_t i = 0; i < 20000; i++) {
+              const size_t writer = rng() % NUM_WRITERS;
+              const int32_t last = progress[writer];
+              if (last < 0) continue;
+
+              const auto key = key_of(writer, (rng() % (last + 1)) & ~1);
+              int32_t value, bound;
+
+              if (!tree.find(thread_ctx, key, value) || value != -key ||
+                  !tree.lower_bound(thread_ctx, key, bound) || bound != key) {
+                throw runtime_error("key went missing");
+              }
+
+              if (i % 5000 == 0) cerr << 'R';
+            }
+          }
+
+          global_ctx.unregister_thread(thread_ctx);
+        },
+        i);
+  }
+
+  for (size_t i = 0; i < NUM_THREADS; i++) {
+    threads[i].join();
+  }
+
+  cerr << endl;
+
+  /* an in-order walk has to see exactly the even keys, sorted */
+  vector<int32_t> keys;
+  vector<rlu::TreeNode<int32_t, int32_t>*> stack;
+
+  for (auto node = tree.root()->child[0]; node || !stack.empty();) {
+    if (node) {
+      stack.push_back(node);
+      node = node->child[0];
+    }
+    else {
+      node = stack.back();
+      stack.pop_back();
+
+      if (!keys.empty() && keys.back() >= node->key) {
+        throw runtime_error("unsorted tree");
+      }
+
+      keys.push_back(node->key);
+      node = node->child[1];
+    }
+  }
+
+  if (keys.size() != NUM_WRITERS * KEYS_PER_WRITER / 2) {
+    throw runtime_error("unexpected size");
+  }
+
+  /* a range scan sees the same keys */
+  auto& thread_ctx = global_ctx.register_thread();
+  size_t i = 100;
+
+  tree.for_each_range(thread_ctx, keys[100], keys[200],
+                      [&keys, &i](const int32_t key, const int32_t) {
+                        if (key != keys[i++]) {
+                          throw runtime_error("inconsistent range scan");
+                        }
+                      });
+
+  if (i != 201) throw runtime_error("short range scan");
+
+  return EXIT_SUCCESS;
+}
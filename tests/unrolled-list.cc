@@ -0,0 +1,145 @@
+#include <iostream>
+#include <random>
+#include <set>
+#include <thread>
+
+#include "rlu.hh"
+#include "unrolled-list.hh"
+
+using namespace std;
+
+constexpr size_t NUM_THREADS = 32;
+
+int32_t randint()
+{
+  static thread_local random_device dev;
+  static thread_local mt19937 rng{dev()};
+  uniform_int_distribution<int32_t> distribution{-1024, 1024};
+
+  return distribution(rng);
+}
+
+/* every node but the head holds some keys, and all of them are in order;
+   with the slab, a node and its header fill exactly one cache line */
+void check_nodes(rlu::UnrolledList<int32_t>& list)
+{
+  constexpr auto CAPACITY = rlu::UnrolledList<int32_t>::CAPACITY;
+  int64_t last = numeric_limits<int64_t>::min();
+
+  for (auto node = list.head()->next; node; node = node->next) {
+    if (node->count == 0 || node->count > CAPACITY) {
+      throw runtime_error("bad node size");
+    }
+
+    const auto header = rlu::util::object_header(node);
+    if (!rlu::mem::SYSTEM_MALLOC &&
+        reinterpret_cast<uintptr_t>(header) % rlu::CACHELINE_SIZE != 0) {
+      throw runtime_error("node straddles cache lines");
+    }
+
+    for (size_t i = 0; i < node->count; i++) {
+      if (node->keys[i] <= last) throw runtime_error("unsorted keys");
+      last = node->keys[i];
+    }
+  }
+}
+
+int main(const int, char*[])
+{
+  rlu::context::Global global_ctx;
+
+  /* first, on a single thread, against a std::set */
+  {
+    rlu::UnrolledList<int32_t> list{512, -1024, 1024};
+    auto& thread_ctx = global_ctx.register_thread();
+
+    set<int32_t> expected;
+    list.for_each(thread_ctx, [&](const int32_t v) { expected.insert(v); });
+
+    if (expected.size() != 512) throw runtime_error("wrong initial size");
+
+    for (size_t i = 0; i < 100000; i++) {
+      const auto value = randint();
+      bool result, expected_result;
+
+      if (i % 3 == 0) {
+        result = list.add(thread_ctx, value);
+        expected_result = expected.insert(value).second;
+      }
+      else if (i % 3 == 1) {
+        result = list.erase(thread_ctx, value);
+        expected_result = expected.erase(value) == 1;
+      }
+      else {
+        result = list.contains(thread_ctx, value);
+        expected_result = expected.count(value) == 1;
+      }
+
+      if (result != expected_result) throw runtime_error("wrong result");
+    }
+
+    check_nodes(list);
+
+    const size_t count = list.for_each_range(
+        thread_ctx, -100, 100, [&](const int32_t value) {
+          if (expected.count(value) == 0) throw runtime_error("bad scan");
+        });
+
+    const auto in_range =
+        distance(expected.lower_bound(-100), expected.upper_bound(100));
+
+    if (count != static_cast<size_t>(in_range)) {
+      throw runtime_error("wrong scan count");
+    }
+
+    global_ctx.unregister_thread(thread_ctx);
+  }
+
+  /* then, with readers scanning while the writers split and merge nodes */
+  rlu::UnrolledList<int32_t> list;
+  vector<thread> threads;
+
+  for (size_t i = 0; i < NUM_THREADS; i++) {
+    threads.emplace_back(
+        [&global_ctx, &list](const bool is_reader) {
+          auto& thread_ctx = global_ctx.register_thread();
+
+          if (is_reader) {
+            for (size_t i = 0; i < 500; i++) {
+              int64_t last = numeric_limits<int64_t>::min();
+
+              list.for_each(thread_ctx, [&last](const int32_t value) {
+                if (value <= last) throw runtime_error("inconsistent list");
+                last = value;
+              });
+
+              if (i % 100 == 0) cerr << 'R';
+            }
+          }
+          else /* it's a writer */ {
+            for (int i = 0; i < 2000; i++) {
+              const auto value = randint();
+
+              if (i % 2) {
+                list.add(thread_ctx, value);
+              }
+              else {
+                list.erase(thread_ctx, value);
+              }
+
+              if (i % 500 == 0) cerr << 'W';
+            }
+          }
+
+          global_ctx.unregister_thread(thread_ctx);
+        },
+        i % 4 == 0);
+  }
+
+  for (auto& t : threads) t.join();
+
+  cerr << endl;
+
+  check_nodes(list);
+  return EXIT_SUCCESS;
+}